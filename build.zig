@@ -4,12 +4,17 @@ const std = @import("std");
 const cpp = @import("./cppkit-zig/build.zig");
 
 var INCLUDE_PATH: []const u8 = undefined;
+var USE_LIBDEFLATE: bool = false;
+var USE_THREADS: bool = false;
 
 pub fn build(b: *std.Build) void {
     var env_map = std.process.getEnvMap(b.allocator) catch @panic("Failed to get environment variables");
     defer env_map.deinit();
     INCLUDE_PATH = env_map.get("FLAKE_INCLUDES") orelse @panic("missing FLAKE_INCLUDES");
 
+    USE_LIBDEFLATE = b.option(bool, "libdeflate", "Build the libdeflate inflate backend (--inflate=libdeflate)") orelse false;
+    USE_THREADS = b.option(bool, "threads", "Build the multi-threaded modes (--pipelined)") orelse false;
+
     const target = b.standardTargetOptions(.{});
     const optimize = b.standardOptimizeOption(.{});
 
@@ -22,7 +27,7 @@ pub fn build(b: *std.Build) void {
         .target = target,
         .optimize = optimize,
         .link_libcpp = true,
-        .single_threaded = true,
+        .single_threaded = !USE_THREADS,
     });
 
     var app_mod_srcs = base_srcs.with("./src", .{
@@ -97,7 +102,14 @@ fn linkupModule(mod: *std.Build.Module) void {
         mod.addIncludePath(.{ .cwd_relative = item });
     }
     mod.addIncludePath(.{ .cwd_relative = "./src/Include" });
-    mod.linkSystemLibrary("minizip", .{});
+    mod.linkSystemLibrary("z", .{});
+    if (USE_THREADS) {
+        mod.addCMacro("EXCEL2CSV_THREADS", "1");
+    }
+    if (USE_LIBDEFLATE) {
+        mod.addCMacro("EXCEL2CSV_LIBDEFLATE", "1");
+        mod.linkSystemLibrary("deflate", .{});
+    }
     mod.linkSystemLibrary("expat", .{});
     mod.linkSystemLibrary("jemalloc", .{});
 }
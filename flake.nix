@@ -36,8 +36,8 @@
               lldb
 
               # Libraries
-              minizip
               zlib
+              libdeflate
               expat
               doctest
               jemalloc
@@ -47,8 +47,8 @@
               unset NIX_CFLAGS_COMPILE
               export FLAKE_INCLUDES="${
                 composeIncludePath [
-                  pkgs.minizip
                   pkgs.zlib
+                  pkgs.libdeflate
                   pkgs.expat
                   pkgs.doctest
                 ]
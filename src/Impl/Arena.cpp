@@ -0,0 +1,73 @@
+#include "Arena.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+void *Arena::allocate(std::size_t size, std::size_t alignment) {
+  // Past the end after adopt() into an empty arena
+  if (m_current < m_blocks.size()) {
+    std::size_t offset = (m_used + alignment - 1) & ~(alignment - 1);
+    if (offset + size <= m_blocks[m_current].size) {
+      m_used = offset + size;
+      return m_blocks[m_current].data.get() + offset;
+    }
+  }
+  // Blocks kept from earlier rounds come next, block starts are aligned
+  while (m_current + 1 < m_blocks.size()) {
+    ++m_current;
+    if (size <= m_blocks[m_current].size) {
+      m_used = size;
+      return m_blocks[m_current].data.get();
+    }
+  }
+
+  std::size_t blockSize = std::max(m_blockSize, size);
+  m_blocks.push_back(
+      {std::make_unique_for_overwrite<std::byte[]>(blockSize), blockSize,
+       false});
+  m_current = m_blocks.size() - 1;
+  m_used = size;
+  return m_blocks.back().data.get();
+}
+
+std::string_view Arena::store(std::string_view text) {
+  if (text.empty()) {
+    return {};
+  }
+  auto data = static_cast<char *>(allocate(text.size(), 1));
+  std::memcpy(data, text.data(), text.size());
+  return {data, text.size()};
+}
+
+void Arena::reset() {
+  std::erase_if(m_blocks, [this](const Block &block) {
+    return block.adopted || block.size > m_blockSize;
+  });
+  m_current = 0;
+  m_used = 0;
+}
+
+void Arena::adopt(Arena &&other) {
+  for (auto &block : other.m_blocks) {
+    block.adopted = true;
+  }
+  // In front of the block being filled, they are full as far as this arena
+  // is concerned
+  m_blocks.insert(m_blocks.begin() + static_cast<std::ptrdiff_t>(m_current),
+                  std::make_move_iterator(other.m_blocks.begin()),
+                  std::make_move_iterator(other.m_blocks.end()));
+  m_current += other.m_blocks.size();
+  other.m_blocks.clear();
+  other.m_current = 0;
+  other.m_used = 0;
+}
+
+std::size_t Arena::capacity() const {
+  std::size_t total = 0;
+  for (const auto &block : m_blocks) {
+    total += block.size;
+  }
+  return total;
+}
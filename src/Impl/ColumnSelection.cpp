@@ -0,0 +1,86 @@
+#include "ColumnSelection.h"
+
+#include <algorithm>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+std::optional<std::uint32_t> parseColumnReference(std::string_view reference) {
+  std::uint32_t column = 0;
+  std::size_t letters = 0;
+  for (char c : reference) {
+    if (c >= 'a' && c <= 'z') {
+      c = static_cast<char>(c - 'a' + 'A');
+    }
+    if (c < 'A' || c > 'Z') {
+      break;
+    }
+    // Bijective base 26: A = 1, Z = 26, AA = 27
+    column = column * 26 + (c - 'A' + 1);
+    if (column > ColumnSelection::kMaxColumns) {
+      return std::nullopt;
+    }
+    ++letters;
+  }
+  if (letters == 0) {
+    return std::nullopt;
+  }
+  return column - 1;
+}
+
+std::optional<ColumnSelection>
+ColumnSelection::fromColumns(std::vector<std::uint32_t> columns) {
+  ColumnSelection selection;
+  for (std::size_t slot = 0; slot < columns.size(); ++slot) {
+    std::uint32_t column = columns[slot];
+    if (column >= kMaxColumns) {
+      return std::nullopt;
+    }
+    if (column >= selection.m_slots.size()) {
+      selection.m_slots.resize(column + 1, kNotSelected);
+    }
+    if (selection.m_slots[column] != kNotSelected) {
+      return std::nullopt;
+    }
+    selection.m_slots[column] = static_cast<std::uint32_t>(slot);
+  }
+  selection.m_columns = std::move(columns);
+  return selection;
+}
+
+// A whole item of the spec must be a column name, not a cell reference
+static std::optional<std::uint32_t> parseColumnName(std::string_view name) {
+  bool lettersOnly = !name.empty() &&
+                     std::all_of(name.begin(), name.end(), [](char c) {
+                       return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+                     });
+  return lettersOnly ? parseColumnReference(name) : std::nullopt;
+}
+
+std::optional<ColumnSelection> ColumnSelection::parse(std::string_view spec) {
+  std::vector<std::uint32_t> columns;
+
+  while (true) {
+    std::size_t comma = spec.find(',');
+    std::string_view item = spec.substr(0, comma);
+
+    std::size_t colon = item.find(':');
+    auto first = parseColumnName(item.substr(0, colon));
+    auto last = colon == std::string_view::npos
+                    ? first
+                    : parseColumnName(item.substr(colon + 1));
+    if (!first.has_value() || !last.has_value() || last < first) {
+      return std::nullopt;
+    }
+    for (std::uint32_t column = *first; column <= *last; ++column) {
+      columns.push_back(column);
+    }
+
+    if (comma == std::string_view::npos) {
+      break;
+    }
+    spec.remove_prefix(comma + 1);
+  }
+
+  return fromColumns(std::move(columns));
+}
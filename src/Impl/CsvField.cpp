@@ -0,0 +1,51 @@
+#include "CsvField.h"
+
+#include <array>
+
+// Bytes that make a field need quotes
+static constexpr std::array<bool, 256> kSpecial = [] {
+  std::array<bool, 256> special{};
+  special[','] = special['"'] = special['\n'] = special['\r'] = true;
+  return special;
+}();
+
+CsvQuoting csvQuotingOf(std::string_view field) {
+  CsvQuoting quoting = CsvQuoting::None;
+  for (char c : field) {
+    if (kSpecial[static_cast<unsigned char>(c)]) {
+      if (c == '"') {
+        return CsvQuoting::Escaped;
+      }
+      quoting = CsvQuoting::Quoted;
+    }
+  }
+  return quoting;
+}
+
+void appendCsvField(std::string &result, std::string_view field,
+                    CsvQuoting quoting) {
+  switch (quoting) {
+  case CsvQuoting::None:
+    result += field;
+    break;
+  case CsvQuoting::Quoted:
+    result += '"';
+    result += field;
+    result += '"';
+    break;
+  case CsvQuoting::Escaped: {
+    result += '"';
+    // Escape internal quotes by doubling them, copying the runs in between
+    std::size_t start = 0;
+    for (auto quote = field.find('"'); quote != std::string_view::npos;
+         quote = field.find('"', start)) {
+      result += field.substr(start, quote + 1 - start);
+      result += '"';
+      start = quote + 1;
+    }
+    result += field.substr(start);
+    result += '"';
+    break;
+  }
+  }
+}
@@ -1,149 +1,73 @@
 #include "ExcelReader.h"
 
-#include <cassert>
-#include <cstring>
+#include <algorithm>
+#include <deque>
 #include <format>
 #include <fstream>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "ParallelSheetParser.h"
+#include "SheetScanner.h"
 #include "StringTableReader.h"
 #include "Utils.h"
-#include "XmlParserState.h"
-#include "expat.h"
-
-ExcelValue createExcelValue(StringTableReader &stringTableReader,
-                            InValue xmlParserState);
-
-class ExcelRowBuilder {
-private:
-  std::vector<ExcelValue> values;
-  bool is_done = false;
-
-public:
-  void push(ExcelValue value) {
-    assert(!this->isBuilt());
-    this->values.push_back(value);
-  }
-  void seal() { this->is_done = true; }
-  bool isBuilt() const { return this->is_done == true; }
-  std::vector<ExcelValue> reset() {
-    std::vector<ExcelValue> result = std::move(this->values);
-    this->values.clear();
-    this->is_done = false;
-    return result;
-  }
-};
-
-class XmlParser {
-private:
-  XmlParserState m_state;
-
-  StringTableReader &stringTableReader;
-  std::vector<std::vector<ExcelValue>> m_rows;
-  ExcelRowBuilder m_currentRowBuilder;
-
-public:
-  XmlParser(StringTableReader &stringTableParser)
-      : stringTableReader(stringTableParser), m_state(WaitingForSheetData{}) {}
-
-  void onElementStart(const char *name, const char **atts) {
-    std::visit(
-        [this, name, atts](auto &&state) {
-          using StateType = std::decay_t<decltype(state)>;
-
-          if constexpr (std::is_same_v<StateType, WaitingForSheetData>) {
-            if (strcmp(name, "sheetData") == 0) {
-              m_state = WaitingForRow{};
-            }
-          } else if constexpr (std::is_same_v<StateType, WaitingForRow>) {
-            if (strcmp(name, "row") == 0) {
-              m_state = WaitingForCell{};
-            }
-          } else if constexpr (std::is_same_v<StateType, WaitingForCell>) {
-            if (strcmp(name, "c") == 0) {
-              std::string cellType;
-              for (int i = 0; atts[i]; i += 2) {
-                if (strcmp(atts[i], "t") == 0) {
-                  cellType = atts[i + 1];
-                  break;
-                }
-              }
-              m_state = WaitingForValue{std::move(cellType)};
-            }
-          } else if constexpr (std::is_same_v<StateType, WaitingForValue>) {
-            if (strcmp(name, "v") == 0) {
-              m_state = InValue{state.cellType, ""};
-            }
-          }
-        },
-        m_state);
-  }
-
-  void onElementEnd(const char *name) {
-    std::visit(
-        [this, name](auto &&state) {
-          using StateType = std::decay_t<decltype(state)>;
-
-          if constexpr (std::is_same_v<StateType, InValue>) {
-            if (strcmp(name, "v") == 0) {
-              auto excelValue = createExcelValue(stringTableReader, state);
-              m_currentRowBuilder.push(excelValue);
-              m_state = WaitingForCell{};
-            }
-          } else if constexpr (std::is_same_v<StateType, WaitingForCell>) {
-            if (strcmp(name, "row") == 0) {
-              // Row is complete
-              m_currentRowBuilder.seal();
-              m_rows.push_back(m_currentRowBuilder.reset());
-              m_state = WaitingForRow{};
-            }
-          } else if constexpr (std::is_same_v<StateType, WaitingForRow>) {
-            if (strcmp(name, "sheetData") == 0) {
-              m_state = Done{};
-            }
-          }
-        },
-        m_state);
-  }
-
-  void onCharacterData(const char *s, int len) {
-    std::visit(
-        [this, s, len](auto &&state) {
-          using StateType = std::decay_t<decltype(state)>;
-
-          if constexpr (std::is_same_v<StateType, InValue>) {
-            std::get<InValue>(m_state).cellValue.append(s, len);
-          }
-        },
-        m_state);
-  }
-
-  std::vector<std::vector<ExcelValue>> extractCompletedRows() {
-    std::vector<std::vector<ExcelValue>> result = std::move(m_rows);
-    m_rows.clear();
-    return result;
-  }
-};
-
-void XMLCALL startElement(void *userData, const char *name, const char **atts) {
-  auto xmlParser = static_cast<XmlParser *>(userData);
-  xmlParser->onElementStart(name, atts);
+#include "XmlParser.h"
+
+std::optional<SheetParserKind> parseSheetParserKind(std::string_view name) {
+  if (name == "fast") {
+    return SheetParserKind::Fast;
+  }
+  if (name == "expat") {
+    return SheetParserKind::Expat;
+  }
+  return std::nullopt;
 }
 
-void XMLCALL endElement(void *userData, const char *name) {
-  auto xmlParser = static_cast<XmlParser *>(userData);
-  xmlParser->onElementEnd(name);
+// Row builder carrying the column projection, row range and number formats
+// both sheet parsers apply
+static ExcelRowBuilder rowBuilderFor(const ExcelReaderOptions &options,
+                                     const StylesReader &styles) {
+  ExcelRowBuilder rowBuilder;
+  rowBuilder.limitRows(options.skipRows, options.maxRows);
+  if (options.rawNumbers) {
+    rowBuilder.keepNumberText();
+  }
+  if (options.numberFormats) {
+    rowBuilder.applyNumberFormats(styles);
+  }
+  if (options.columns.has_value()) {
+    rowBuilder.project(options.columns.value());
+  } else if (!options.columnHeaders.empty()) {
+    rowBuilder.projectByHeader(options.columnHeaders);
+  }
+  return rowBuilder;
 }
 
-void XMLCALL charDataHandler(void *userData, const char *s, int len) {
-  auto xmlParser = static_cast<XmlParser *>(userData);
-  xmlParser->onCharacterData(s, len);
+#ifdef EXCEL2CSV_THREADS
+// Rows [first, last) of a chunk of `count` rows starting at row `seen` of the
+// sheet that fall in its rows [begin, end)
+static std::pair<std::size_t, std::size_t> rowRange(std::size_t seen,
+                                                    std::size_t count,
+                                                    std::size_t begin,
+                                                    std::size_t end) {
+  std::size_t first = std::min(count, begin > seen ? begin - seen : 0);
+  std::size_t last = std::min(count, end > seen ? end - seen : 0);
+  return {first, std::max(first, last)};
 }
+#endif
 
-generator<std::vector<ExcelValue>>
-ExcelReader::read(std::string_view filePath) {
+static void checkHeaders(const ExcelRowBuilder &rowBuilder) {
+  if (!rowBuilder.missingHeaders().empty()) {
+    throw std::invalid_argument(std::format(
+        "Column header '{}' not found", rowBuilder.missingHeaders().front()));
+  }
+}
+
+generator<ExcelReader::RowChunk>
+ExcelReader::readRows(std::string_view filePath,
+                      StringTableReader &sharedStrings, StylesReader &styles) {
   std::ifstream file(filePath.data(), std::ios::binary | std::ios::ate);
   if (!file.is_open()) {
     throw MalformedExcelFileException(
@@ -156,73 +80,231 @@ ExcelReader::read(std::string_view filePath) {
         std::format("Failed to open Excel file '{}'", filePath.data()));
   }
 
-  StringTableReader stringTableReader;
-  stringTableReader.collect(excelZipArchive.value());
+  if (m_options.maxRows == 0) {
+    co_return;
+  }
+
+  ZipReadOptions zipOptions{.inflateBackend = m_options.inflateBackend,
+                            .pipelined = m_options.pipelined,
+                            .chunkSize = m_options.chunkSize};
+  // Shared by both entries, so the sheet reuses the shared strings' buffer
+  std::vector<std::byte> buffer;
 
-  auto parser = XML_ParserCreate(nullptr);
-  if (!parser) {
-    throw std::runtime_error("Failed to allocate parser");
+  sharedStrings = StringTableReader(m_options.sharedStringsBudget,
+                                    m_options.lazySharedStrings);
+#ifdef EXCEL2CSV_THREADS
+  if (m_options.concurrentSharedStrings) {
+    // A handle of its own, the thread may outlast this one
+    auto stringsArchive = ZipUtils::open(filePath);
+    if (!stringsArchive.has_value()) {
+      throw MalformedExcelFileException(
+          std::format("Failed to open Excel file '{}'", filePath.data()));
+    }
+    sharedStrings.collectInBackground(std::move(stringsArchive.value()),
+                                        zipOptions);
+  } else {
+    sharedStrings.collect(excelZipArchive.value(), buffer, zipOptions);
+  }
+#else
+  sharedStrings.collect(excelZipArchive.value(), buffer, zipOptions);
+#endif
+  if (m_options.numberFormats) {
+    styles.collect(excelZipArchive.value(), buffer, zipOptions);
   }
 
-  XmlParser rowParser(stringTableReader);
+  // Rows handed out, swapped with the parser's batch after every chunk so
+  // both keep their memory. A row stays valid until the batch is refilled
+  RowBatch rows;
+  // Rows already handed out by a parser that gave up
+  std::size_t rowsToSkip = 0;
+  SheetParserKind sequentialParser = m_options.parser;
 
-  XML_SetUserData(parser, &rowParser);
-  XML_SetElementHandler(parser, startElement, endElement);
-  XML_SetCharacterDataHandler(parser, charDataHandler);
-  XML_SetParamEntityParsing(parser, XML_PARAM_ENTITY_PARSING_NEVER);
+#ifdef EXCEL2CSV_THREADS
+  // Segments don't know their rows' position in the sheet, so the row range
+  // is applied here. Header projection needs the first row first and stays
+  // sequential
+  if (m_options.threads > 1 && m_options.columnHeaders.empty()) {
+    ExcelRowBuilder segmentBuilder;
+    if (m_options.columns.has_value()) {
+      segmentBuilder.project(m_options.columns.value());
+    }
+    if (m_options.rawNumbers) {
+      segmentBuilder.keepNumberText();
+    }
+    if (m_options.numberFormats) {
+      segmentBuilder.applyNumberFormats(styles);
+    }
+    ParallelSheetParser parallelParser(sharedStrings,
+                                       std::move(segmentBuilder),
+                                       m_options.parser, m_options.threads);
+    std::size_t rowsSeen = 0;
+    std::size_t rowsEnd = m_options.maxRows.has_value()
+                              ? m_options.skipRows + m_options.maxRows.value()
+                              : SIZE_MAX;
+    bool supported = true;
 
-  // Parse the XML file chunk by chunk and yield rows as they're completed
-  for (auto &chunk : ZipUtils::readFileChunked(excelZipArchive.value(),
-                                               "xl/worksheets/sheet1.xml")) {
-    auto start = reinterpret_cast<char *>(chunk.data());
-    int end = chunk.size();
-    if (XML_Parse(parser, start, end, XML_FALSE) == XML_FALSE) {
-      XML_ParserFree(parser);
-      throw MalformedExcelFileException(
-          "Error while reading xl/worksheets/sheet1.xml");
+    for (auto &chunk : ZipUtils::readFileChunked(excelZipArchive.value(),
+                                                 "xl/worksheets/sheet1.xml",
+                                                 buffer, zipOptions)) {
+      supported = parallelParser.feed(chunk);
+      parallelParser.extractCompletedRows(rows);
+      auto [first, last] = rowRange(rowsSeen, rows.size(), m_options.skipRows,
+                                    rowsEnd);
+      rowsSeen += rows.size();
+      rowsToSkip += last - first;
+      if (first < last) {
+        co_yield RowChunk{&rows, first, last};
+      }
+      if (!supported || parallelParser.isDone() || rowsSeen >= rowsEnd) {
+        break;
+      }
     }
 
-    // After parsing each chunk, yield any completed rows
-    auto completedRows = rowParser.extractCompletedRows();
-    for (auto &row : completedRows) {
-      co_yield std::move(row);
+    if (rowsSeen >= rowsEnd) {
+      sharedStrings.finishCollecting();
+      co_return;
+    }
+    if (supported && parallelParser.finish()) {
+      parallelParser.extractCompletedRows(rows);
+      auto [first, last] = rowRange(rowsSeen, rows.size(), m_options.skipRows,
+                                    rowsEnd);
+      if (first < last) {
+        co_yield RowChunk{&rows, first, last};
+      }
+      sharedStrings.finishCollecting();
+      co_return;
     }
+    // A cut landed inside markup, re-parse the sheet sequentially with expat
+    sequentialParser = SheetParserKind::Expat;
   }
+#endif
 
-  // Parse the final chunk
-  if (XML_Parse(parser, nullptr, 0, XML_TRUE) == XML_FALSE) {
-    XML_ParserFree(parser);
-    throw MalformedExcelFileException(
-        "Error finalizing XML parse of xl/worksheets/sheet1.xml");
+  if (sequentialParser == SheetParserKind::Fast) {
+    SheetScanner scanner(sharedStrings, rowBuilderFor(m_options, styles));
+    bool supported = true;
+
+    for (auto &chunk : ZipUtils::readFileChunked(excelZipArchive.value(),
+                                                 "xl/worksheets/sheet1.xml",
+                                                 buffer, zipOptions)) {
+      if (!scanner.feed(chunk)) {
+        supported = false;
+        break;
+      }
+
+      scanner.extractCompletedRows(rows);
+      checkHeaders(scanner.rowBuilder());
+      rowsToSkip += rows.size();
+      if (!rows.empty()) {
+        co_yield RowChunk{&rows, 0, rows.size()};
+      }
+      if (scanner.isDone()) {
+        // Past </sheetData> or the row range. Leaving the loop closes the
+        // entry, nothing more is inflated
+        break;
+      }
+    }
+
+    if (supported && scanner.finish()) {
+      scanner.extractCompletedRows(rows);
+      checkHeaders(scanner.rowBuilder());
+      if (!rows.empty()) {
+        co_yield RowChunk{&rows, 0, rows.size()};
+      }
+      sharedStrings.finishCollecting();
+      co_return;
+    }
+    // Markup outside the scanner's subset, re-parse the sheet with expat
+  }
+
+  auto parser = createXmlParser();
+  XmlParser rowParser(sharedStrings, rowBuilderFor(m_options, styles));
+  rowParser.attach(parser.get());
+
+  // Parse the XML file chunk by chunk and yield rows as they're completed,
+  // skipping those a parser that gave up already handed out
+  for ([[maybe_unused]] auto parsedBytes :
+       parseZipEntry(parser.get(), excelZipArchive.value(),
+                     "xl/worksheets/sheet1.xml", buffer, zipOptions)) {
+    rowParser.extractCompletedRows(rows);
+    checkHeaders(rowParser.rowBuilder());
+    std::size_t first = std::min(rowsToSkip, rows.size());
+    rowsToSkip -= first;
+    if (first < rows.size()) {
+      co_yield RowChunk{&rows, first, rows.size()};
+    }
   }
 
   // Yield any remaining completed rows
-  auto remainingRows = rowParser.extractCompletedRows();
-  for (auto &row : remainingRows) {
-    co_yield std::move(row);
-  }
-
-  XML_ParserFree(parser);
-};
-
-ExcelValue createExcelValue(StringTableReader &stringTableReader,
-                            InValue state) {
-  ExcelValue value;
-  if (state.cellType == "s") {
-    int index = stringToNumber(state.cellValue);
-    auto stringEntry = stringTableReader.getStringEntry(index);
-    value = stringEntry.has_value() ? stringEntry.value() : state.cellValue;
-  } else if (state.cellType == "b") {
-    // Boolean type
-    value = (state.cellValue == "1");
-  } else {
-    // Numeric type (empty cellType means number)
-    try {
-      value = std::stod(state.cellValue);
-    } catch (const std::exception &) {
-      value = state.cellValue; // Fallback to string if conversion fails
+  rowParser.extractCompletedRows(rows);
+  checkHeaders(rowParser.rowBuilder());
+  std::size_t first = std::min(rowsToSkip, rows.size());
+  rowsToSkip -= first;
+  if (first < rows.size()) {
+    co_yield RowChunk{&rows, first, rows.size()};
+  }
+  sharedStrings.finishCollecting();
+}
+
+generator<ExcelRow> ExcelReader::readCells(std::string_view filePath) {
+  // Local to this call, so they outlive its rows and no other read replaces
+  // them
+  StringTableReader sharedStrings;
+  StylesReader styles;
+  for (auto chunk : readRows(filePath, sharedStrings, styles)) {
+    for (std::size_t row = chunk.first; row < chunk.last; ++row) {
+      co_yield ExcelRow((*chunk.rows)[row], sharedStrings, styles);
+    }
+  }
+}
+
+generator<std::vector<ExcelValue>>
+ExcelReader::read(std::string_view filePath) {
+  for (auto row : readCells(filePath)) {
+    std::vector<ExcelValue> values;
+    values.reserve(row.size());
+    for (const auto &cell : row) {
+      values.push_back(toExcelValue(cell, row.sharedStrings()));
     }
+    co_yield std::move(values);
   }
+}
 
-  return value;
-}
\ No newline at end of file
+generator<RecordBatch> ExcelReader::readBatches(std::string_view filePath,
+                                                std::size_t batchRows) {
+  if (batchRows == 0) {
+    throw std::invalid_argument("Batches need at least one row");
+  }
+  StringTableReader sharedStrings;
+  StylesReader styles;
+  // The parser's batches are taken over rather than copied, the next batch's
+  // rows point into them. A deque, so they don't move
+  std::deque<RowBatch> chunks;
+  // Cleared chunks handed back to the parser, so it refills warm memory
+  std::vector<RowBatch> spares;
+  std::vector<std::span<const ExcelCell>> rows;
+  rows.reserve(batchRows);
+  for (auto chunk : readRows(filePath, sharedStrings, styles)) {
+    RowBatch &taken = chunks.emplace_back();
+    if (!spares.empty()) {
+      std::swap(taken, spares.back());
+      spares.pop_back();
+    }
+    std::swap(taken, *chunk.rows);
+    for (std::size_t row = chunk.first; row < chunk.last; ++row) {
+      rows.push_back(chunks.back()[row]);
+      if (rows.size() == batchRows) {
+        co_yield RecordBatch::fromRows(rows, sharedStrings);
+        rows.clear();
+        // Rows left for the next batch are all in the last chunk
+        while (chunks.size() > 1) {
+          chunks.front().clear();
+          std::swap(spares.emplace_back(), chunks.front());
+          chunks.pop_front();
+        }
+      }
+    }
+  }
+  if (!rows.empty()) {
+    co_yield RecordBatch::fromRows(rows, sharedStrings);
+  }
+}
@@ -1,30 +1,47 @@
-#include "ExcelValue.h"
-#include "Utils.h"
+#include "ExcelRow2Csv.h"
+#include "CsvField.h"
+#include "NumberCodec.h"
+#include "StringTableReader.h"
+#include "StylesReader.h"
 #include <string>
+#include <string_view>
 #include <vector>
 
-std::string excelRow2Csv(std::vector<ExcelValue> line) {
+std::string excelRow2Csv(std::span<const ExcelCell> line,
+                         const StringTableReader *sharedStrings,
+                         const StylesReader *styles) {
+  std::string result;
+  excelRow2Csv(line, result, sharedStrings, styles);
+  return result;
+}
+
+void excelRow2Csv(std::span<const ExcelCell> line, std::string &result,
+                  const StringTableReader *sharedStrings,
+                  const StylesReader *styles) {
+  // Text of string cells, shared strings are copied straight from the table
+  auto textOf = [sharedStrings](const ExcelCell &cell) -> std::string_view {
+    if (cell.kind() == ExcelCell::Kind::String) {
+      return cell.asString();
+    }
+    return sharedStrings->getStringEntry(cell.sharedStringIndex());
+  };
+
   // Pre-calculate approximate size for string pre-allocation
   size_t estimated_size = 0;
-  for (const auto &value : line) {
-    std::visit(
-        [&estimated_size](const auto &v) {
-          using T = std::decay_t<decltype(v)>;
-          if constexpr (std::is_same_v<T, std::string>) {
-            estimated_size +=
-                v.length() + 3; // +3 for potential quotes and comma
-          } else if constexpr (std::is_same_v<T, double>) {
-            estimated_size += 6; // should be enough
-          } else if constexpr (std::is_same_v<T, bool>) {
-            estimated_size += 6; // "false" + comma or "true" + comma
-          }
-        },
-        value);
+  for (const auto &cell : line) {
+    if (cell.kind() == ExcelCell::Kind::String ||
+        cell.kind() == ExcelCell::Kind::SharedString) {
+      estimated_size +=
+          textOf(cell).length() + 3; // +3 for potential quotes and comma
+    } else if (cell.kind() == ExcelCell::Kind::NumberText) {
+      estimated_size += cell.asNumberText().length() + 1;
+    } else {
+      estimated_size += 6; // "false" + comma, and should do for numbers
+    }
   }
 
   // Reserve space for the result string
-  std::string result;
-  result.reserve(estimated_size);
+  result.reserve(result.size() + estimated_size);
 
   // Convert each value to CSV format
   for (size_t i = 0; i < line.size(); ++i) {
@@ -32,38 +49,42 @@ std::string excelRow2Csv(std::vector<ExcelValue> line) {
       result += ',';
     }
 
-    std::visit(
-        [&result](const auto &v) {
-          using T = std::decay_t<decltype(v)>;
-          if constexpr (std::is_same_v<T, std::string>) {
-            // Check if string needs quoting (contains comma, quote, or newline)
-            bool needs_quoting = v.find(',') != std::string::npos ||
-                                 v.find('"') != std::string::npos ||
-                                 v.find('\n') != std::string::npos ||
-                                 v.find('\r') != std::string::npos;
-
-            if (needs_quoting) {
-              result += '"';
-              // Escape internal quotes by doubling them
-              for (char c : v) {
-                if (c == '"') {
-                  result += "\"\"";
-                } else {
-                  result += c;
-                }
-              }
-              result += '"';
-            } else {
-              result += v;
-            }
-          } else if constexpr (std::is_same_v<T, double>) {
-            result += doubleToString(v);
-          } else if constexpr (std::is_same_v<T, bool>) {
-            result += v ? "true" : "false";
-          }
-        },
-        line[i]);
+    switch (line[i].kind()) {
+    case ExcelCell::Kind::String:
+      appendCsvField(result, line[i].asString());
+      break;
+    case ExcelCell::Kind::SharedString: {
+      // Whether it needs quotes was worked out once, when it was collected
+      std::uint32_t index = line[i].sharedStringIndex();
+      appendCsvField(result, sharedStrings->getStringEntry(index),
+                     sharedStrings->csvQuoting(index));
+      break;
+    }
+    case ExcelCell::Kind::Number:
+      if (styles != nullptr && line[i].numberFormat() != 0) {
+        char buffer[kMaxNumberLength];
+        const auto &format = styles->format(line[i].numberFormat());
+        result.append(buffer, format.write(line[i].asNumber(), buffer));
+      } else {
+        appendNumber(result, line[i].asNumber());
+      }
+      break;
+    case ExcelCell::Kind::NumberText:
+      // Digits, sign, point and exponent never need quoting
+      result += line[i].asNumberText();
+      break;
+    case ExcelCell::Kind::Boolean:
+      result += line[i].asBoolean() ? "true" : "false";
+      break;
+    }
   }
+}
 
-  return result;
+std::string excelRow2Csv(std::vector<ExcelValue> line) {
+  std::vector<ExcelCell> cells;
+  cells.reserve(line.size());
+  for (const auto &value : line) {
+    cells.push_back(toExcelCell(value));
+  }
+  return excelRow2Csv(cells);
 }
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "LazyStringTable.h"
+
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <strings.h>
+#include <utility>
+
+#include "XmlTag.h"
+
+// List node and hash map node of a cached string, roughly
+constexpr std::size_t kCacheEntryOverhead = 64;
+
+LazyStringTable::~LazyStringTable() {
+  if (m_parser != nullptr) {
+    XML_ParserFree(m_parser);
+  }
+}
+
+void XMLCALL LazyStringTable::startElement(void *userData, const char *name,
+                                           const char ** /*atts*/) {
+  auto *table = static_cast<LazyStringTable *>(userData);
+  XmlTag tag = classifyTag(name);
+  if (tag == XmlTag::Si) {
+    table->m_inItem = true;
+  } else if (tag == XmlTag::T && table->m_inItem) {
+    table->m_inText = true;
+  }
+}
+
+void XMLCALL LazyStringTable::endElement(void *userData, const char *name) {
+  auto *table = static_cast<LazyStringTable *>(userData);
+  XmlTag tag = classifyTag(name);
+  if (tag == XmlTag::Si) {
+    // The next item's bytes follow, they're not part of this document
+    XML_StopParser(table->m_parser, XML_FALSE);
+  } else if (tag == XmlTag::T) {
+    table->m_inText = false;
+  }
+}
+
+void XMLCALL LazyStringTable::charDataHandler(void *userData, const char *s,
+                                              int len) {
+  auto *table = static_cast<LazyStringTable *>(userData);
+  if (table->m_inItem && table->m_inText) {
+    table->m_text.append(s, len);
+  }
+}
+
+// Whether `xml` is UTF-8, as far as its byte order mark and XML declaration
+// tell
+static bool isUtf8(std::string_view xml) {
+  if (xml.starts_with("\xEF\xBB\xBF")) {
+    xml.remove_prefix(3);
+  }
+  // UTF-16 and UTF-32 start with a byte order mark or a zero byte
+  if (!xml.empty() && (xml[0] == '\xFE' || xml[0] == '\xFF' || xml[0] == 0)) {
+    return false;
+  }
+  if (!xml.starts_with("<?xml")) {
+    return true;
+  }
+  auto declaration = xml.substr(0, xml.find("?>"));
+  auto encoding = declaration.find("encoding");
+  if (encoding == std::string_view::npos) {
+    return true;
+  }
+  auto open = declaration.find_first_of("\"'", encoding);
+  if (open == std::string_view::npos) {
+    return false;
+  }
+  auto close = declaration.find(declaration[open], open + 1);
+  auto name = declaration.substr(open + 1, close - open - 1);
+  return name.size() == 5 && strncasecmp(name.data(), "utf-8", 5) == 0;
+}
+
+bool LazyStringTable::index(std::string_view xml) {
+  if (!isUtf8(xml)) {
+    return false;
+  }
+  const char *begin = xml.data();
+  const char *end = begin + xml.size();
+  auto skipPast = [&](const char *from, std::string_view terminator) {
+    std::string_view rest(from, end - from);
+    auto found = rest.find(terminator);
+    return found == std::string_view::npos
+               ? end
+               : from + found + terminator.size();
+  };
+
+  const char *p = begin;
+  while ((p = static_cast<const char *>(std::memchr(p, '<', end - p)))) {
+    std::string_view markup(p, end - p);
+    if (markup.starts_with("<!--")) {
+      p = skipPast(p + 4, "-->");
+    } else if (markup.starts_with("<![CDATA[")) {
+      p = skipPast(p + 9, "]]>");
+    } else if (markup.starts_with("<!")) {
+      // A DTD may declare entities the items use
+      return false;
+    } else if (markup.starts_with("<?")) {
+      p = skipPast(p + 2, "?>");
+    } else {
+      if (markup.size() > 3 && markup[1] == 's' && markup[2] == 'i' &&
+          std::string_view(">/ \t\r\n").find(markup[3]) !=
+              std::string_view::npos) {
+        m_offsets.push_back(static_cast<std::uint64_t>(p - begin));
+      }
+      p++;
+    }
+  }
+  m_offsets.push_back(xml.size());
+  return true;
+}
+
+bool LazyStringTable::collect(const ZipArchive &excelArchive,
+                              std::vector<std::byte> &buffer,
+                              ZipReadOptions zipOptions) {
+  for (auto chunk : ZipUtils::readFileChunked(
+           excelArchive, "xl/sharedStrings.xml", buffer, zipOptions)) {
+    m_items.append({reinterpret_cast<const char *>(chunk.data()),
+                    chunk.size()});
+  }
+  m_items.map();
+  if (!index(m_items.view(0, m_items.size()))) {
+    m_offsets.clear();
+    return false;
+  }
+  m_parser = XML_ParserCreate(nullptr);
+  if (m_parser == nullptr) {
+    throw std::runtime_error("Failed to allocate parser");
+  }
+  return true;
+}
+
+std::string LazyStringTable::decode(std::size_t stringIndex) {
+  XML_ParserReset(m_parser, nullptr);
+  XML_SetUserData(m_parser, this);
+  XML_SetElementHandler(m_parser, startElement, endElement);
+  XML_SetCharacterDataHandler(m_parser, charDataHandler);
+  m_text.clear();
+  m_inItem = false;
+  m_inText = false;
+
+  std::uint64_t begin = m_offsets[stringIndex];
+  auto item = m_items.view(begin, m_offsets[stringIndex + 1] - begin);
+  assert(item.size() <= std::numeric_limits<int>::max());
+  // Final, so an item missing its </si> is an error
+  if (XML_Parse(m_parser, item.data(), static_cast<int>(item.size()),
+                XML_TRUE) == XML_STATUS_ERROR &&
+      XML_GetErrorCode(m_parser) != XML_ERROR_ABORTED) {
+    throw MalformedExcelFileException(
+        "Error while reading xl/sharedStrings.xml");
+  }
+  return std::move(m_text);
+}
+
+const LazyStringTable::CacheEntry &
+LazyStringTable::lookup(std::size_t stringIndex) {
+  assert(stringIndex < size());
+  if (auto cached = m_cached.find(stringIndex); cached != m_cached.end()) {
+    m_recent.splice(m_recent.begin(), m_recent, cached->second);
+    return *cached->second;
+  }
+
+  std::string text = decode(stringIndex);
+  CsvQuoting quoting = csvQuotingOf(text);
+  m_recent.push_front({stringIndex, std::move(text), quoting});
+  m_cached.emplace(stringIndex, m_recent.begin());
+  m_cacheUsed += m_recent.front().text.size() + kCacheEntryOverhead;
+  // The string just decoded stays, however small the budget
+  while (m_cacheUsed > m_cacheBudget && m_recent.size() > 1) {
+    const auto &oldest = m_recent.back();
+    m_cacheUsed -= oldest.text.size() + kCacheEntryOverhead;
+    m_cached.erase(oldest.index);
+    m_recent.pop_back();
+  }
+  return m_recent.front();
+}
+
+std::string_view LazyStringTable::get(std::size_t stringIndex) {
+  std::lock_guard lock(m_mutex);
+  return lookup(stringIndex).text;
+}
+
+CsvQuoting LazyStringTable::csvQuoting(std::size_t stringIndex) {
+  std::lock_guard lock(m_mutex);
+  return lookup(stringIndex).quoting;
+}
+
+std::size_t LazyStringTable::cachedCount() {
+  std::lock_guard lock(m_mutex);
+  return m_recent.size();
+}
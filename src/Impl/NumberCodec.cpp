@@ -0,0 +1,76 @@
+#include "NumberCodec.h"
+
+#include <cassert>
+#include <charconv>
+#include <cmath>
+#include <system_error>
+
+std::optional<double> parseNumber(std::string_view text) {
+  double number = 0;
+  const char *end = text.data() + text.size();
+  auto [ptr, error] = std::from_chars(text.data(), end, number);
+  if (error != std::errc() || ptr != end) {
+    return std::nullopt;
+  }
+  return number;
+}
+
+static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+bool isNumberText(std::string_view text) {
+  std::size_t i = 0;
+  // Like std::from_chars, a leading '+' is only allowed in the exponent
+  auto skipSign = [&](bool plus) {
+    if (i < text.size() && (text[i] == '-' || (plus && text[i] == '+'))) {
+      ++i;
+    }
+  };
+  auto skipDigits = [&] {
+    std::size_t start = i;
+    while (i < text.size() && isDigit(text[i])) {
+      ++i;
+    }
+    return i - start;
+  };
+
+  skipSign(false);
+  std::size_t digits = skipDigits();
+  if (i < text.size() && text[i] == '.') {
+    ++i;
+    digits += skipDigits();
+  }
+  if (digits == 0) {
+    return false;
+  }
+  if (i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+    ++i;
+    skipSign(true);
+    if (skipDigits() == 0) {
+      return false;
+    }
+  }
+  return i == text.size();
+}
+
+char *formatNumber(double number, char *buffer) {
+  if (number == 0) {
+    // Negative zero too
+    *buffer = '0';
+    return buffer + 1;
+  }
+  // Where JavaScript switches notations too, plain decimals up to 1e21 take
+  // at most 22 digits
+  double magnitude = std::fabs(number);
+  auto format = magnitude >= 1e-7 && magnitude < 1e21
+                    ? std::chars_format::fixed
+                    : std::chars_format::scientific;
+  auto [end, error] =
+      std::to_chars(buffer, buffer + kMaxNumberLength, number, format);
+  assert(error == std::errc());
+  return end;
+}
+
+void appendNumber(std::string &result, double number) {
+  char buffer[kMaxNumberLength];
+  result.append(buffer, formatNumber(number, buffer));
+}
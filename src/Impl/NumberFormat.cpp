@@ -0,0 +1,235 @@
+#include "NumberFormat.h"
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <cmath>
+#include <system_error>
+
+#include "NumberCodec.h"
+
+// Serial of 10000-01-01, the first date Excel can't show
+constexpr double kMaxSerial = 2958466;
+constexpr std::int64_t kSecondsPerDay = 86400;
+
+NumberFormat NumberFormat::builtIn(std::uint32_t numFmtId) {
+  switch (numFmtId) {
+  case 1:
+  case 3:
+    return {Kind::Fixed, 0};
+  case 2:
+  case 4:
+    return {Kind::Fixed, 2};
+  case 9:
+    return {Kind::Percent, 0};
+  case 10:
+    return {Kind::Percent, 2};
+  case 14:
+  case 15:
+  case 16:
+  case 17:
+    return Kind::Date;
+  case 18:
+  case 19:
+  case 20:
+  case 21:
+  case 45:
+  case 47:
+    return Kind::Time;
+  case 22:
+    return Kind::DateTime;
+  case 46:
+    return Kind::Duration;
+  default:
+    return Kind::General;
+  }
+}
+
+static char lower(char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
+
+static bool startsWithNoCase(std::string_view text, std::string_view prefix) {
+  return text.size() >= prefix.size() &&
+         std::equal(prefix.begin(), prefix.end(), text.begin(),
+                    [](char a, char b) { return lower(a) == lower(b); });
+}
+
+NumberFormat NumberFormat::compile(std::string_view formatCode) {
+  if (startsWithNoCase(formatCode, "general")) {
+    return Kind::General;
+  }
+
+  bool date = false;
+  bool time = false;
+  bool elapsed = false;
+  bool month = false;
+  bool percent = false;
+  bool digits = false;
+  // Only digit placeholders, separators and % make a percent or fixed format
+  bool plain = true;
+  bool afterPoint = false;
+  int decimals = 0;
+
+  for (std::size_t i = 0; i < formatCode.size(); ++i) {
+    std::string_view rest = formatCode.substr(i);
+    char c = lower(formatCode[i]);
+    if (c == ';') {
+      break;
+    }
+    if (c == '"') {
+      // Literal text
+      i = std::min(formatCode.find('"', i + 1), formatCode.size());
+      plain = false;
+    } else if (c == '\\' || c == '_' || c == '*') {
+      // Escaped character, or padding to the width of the next one
+      ++i;
+      plain = false;
+    } else if (c == '[') {
+      // Colors and locales, or elapsed hours, minutes and seconds
+      std::size_t end = std::min(formatCode.find(']', i), formatCode.size());
+      auto token = formatCode.substr(i + 1, end - i - 1);
+      char unit = token.empty() ? '\0' : lower(token[0]);
+      // Only [h], [mm], [ss] and the like, not [Magenta]
+      if ((unit == 'h' || unit == 'm' || unit == 's') &&
+          std::ranges::all_of(token, [unit](char u) {
+            return lower(u) == unit;
+          })) {
+        elapsed = true;
+      }
+      i = end;
+    } else if (startsWithNoCase(rest, "am/pm") ||
+               startsWithNoCase(rest, "a/p")) {
+      time = true;
+      i += lower(rest[1]) == 'm' ? 4 : 2;
+    } else if (c == 'y' || c == 'd') {
+      date = true;
+    } else if (c == 'm') {
+      month = true;
+    } else if (c == 'h' || c == 's') {
+      time = true;
+    } else if (c == '0' || c == '#' || c == '?') {
+      digits = true;
+      decimals += afterPoint ? 1 : 0;
+    } else if (c == '.') {
+      afterPoint = true;
+    } else if (c == '%') {
+      percent = true;
+    } else if (c != ',') {
+      plain = false;
+    }
+  }
+
+  // m means months unless hours or seconds are around
+  date = date || (month && !time && !elapsed);
+  if (elapsed) {
+    return Kind::Duration;
+  }
+  if (date) {
+    return time ? Kind::DateTime : Kind::Date;
+  }
+  if (time) {
+    return Kind::Time;
+  }
+  if (digits && plain) {
+    return {percent ? Kind::Percent : Kind::Fixed,
+            static_cast<std::uint8_t>(std::min<int>(decimals, kMaxDecimals))};
+  }
+  return Kind::General;
+}
+
+// Writes `value` as `width` digits
+static char *writeDigits(char *buffer, unsigned value, int width) {
+  for (int i = width - 1; i >= 0; --i) {
+    buffer[i] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  }
+  return buffer + width;
+}
+
+// Year, month and day of `days` since 1970-01-01, see
+// http://howardhinnant.github.io/date_algorithms.html#civil_from_days
+static char *writeCivilDate(char *buffer, std::int64_t days) {
+  days += 719468;
+  std::int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  auto dayOfEra = static_cast<unsigned>(days - era * 146097);
+  unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 -
+                        dayOfEra / 146096) /
+                       365;
+  unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 -
+                                   yearOfEra / 100);
+  unsigned shiftedMonth = (5 * dayOfYear + 2) / 153;
+  unsigned day = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+  unsigned month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+  auto year = static_cast<unsigned>(yearOfEra + era * 400 + (month <= 2));
+
+  buffer = writeDigits(buffer, year, 4);
+  *buffer++ = '-';
+  buffer = writeDigits(buffer, month, 2);
+  *buffer++ = '-';
+  return writeDigits(buffer, day, 2);
+}
+
+static char *writeTimeOfDay(char *buffer, unsigned seconds) {
+  buffer = writeDigits(buffer, seconds / 3600, 2);
+  *buffer++ = ':';
+  buffer = writeDigits(buffer, seconds / 60 % 60, 2);
+  *buffer++ = ':';
+  return writeDigits(buffer, seconds % 60, 2);
+}
+
+char *NumberFormat::write(double number, char *buffer) const {
+  switch (m_kind) {
+  case Kind::General:
+    break;
+  case Kind::Date:
+  case Kind::Time:
+  case Kind::DateTime:
+  case Kind::Duration: {
+    if (!(number >= 0 && number < kMaxSerial)) {
+      break;
+    }
+    // Rounded to the second first, like Excel does
+    auto seconds = static_cast<std::int64_t>(
+        std::llround(number * static_cast<double>(kSecondsPerDay)));
+    std::int64_t serialDay = seconds / kSecondsPerDay;
+    auto timeOfDay = static_cast<unsigned>(seconds % kSecondsPerDay);
+
+    if (m_kind == Kind::Duration) {
+      // Hours unpadded, then what's left like a time of day
+      buffer =
+          std::to_chars(buffer, buffer + kMaxNumberLength, seconds / 3600).ptr;
+      char time[8];
+      writeTimeOfDay(time, static_cast<unsigned>(seconds % 3600));
+      return std::copy(time + 2, time + 8, buffer);
+    }
+    if (m_kind == Kind::Time) {
+      return writeTimeOfDay(buffer, timeOfDay);
+    }
+    // Serial 1 is 1900-01-01 and 60 the 1900-02-29 Lotus made up, 25569 is
+    // 1970-01-01
+    buffer =
+        writeCivilDate(buffer, serialDay - (serialDay < 61 ? 25568 : 25569));
+    if (m_kind == Kind::DateTime) {
+      *buffer++ = 'T';
+      buffer = writeTimeOfDay(buffer, timeOfDay);
+    }
+    return buffer;
+  }
+  case Kind::Percent:
+  case Kind::Fixed: {
+    double value = m_kind == Kind::Percent ? number * 100 : number;
+    // Wider values wouldn't fit, NaN and infinities go too
+    if (!(std::fabs(value) < 1e15)) {
+      break;
+    }
+    auto [end, error] =
+        std::to_chars(buffer, buffer + kMaxNumberLength - 1, value,
+                      std::chars_format::fixed, m_decimals);
+    assert(error == std::errc());
+    if (m_kind == Kind::Percent) {
+      *end++ = '%';
+    }
+    return end;
+  }
+  }
+  return formatNumber(number, buffer);
+}
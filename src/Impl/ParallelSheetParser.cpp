@@ -0,0 +1,204 @@
+#include "ParallelSheetParser.h"
+
+#ifdef EXCEL2CSV_THREADS
+
+#include <chrono>
+#include <utility>
+
+#include "SheetScanner.h"
+#include "expat.h"
+
+namespace {
+
+constexpr std::string_view kSheetDataOpen = "<sheetData>";
+constexpr std::string_view kSheetDataClose = "</sheetData>";
+
+std::span<const std::byte> asBytes(std::string_view text) {
+  return std::as_bytes(std::span(text.data(), text.size()));
+}
+
+// Position of the first `<row` start tag in [from, limit), npos if none
+std::size_t findRowStart(std::string_view text, std::size_t from,
+                         std::size_t limit) {
+  for (std::size_t pos = text.find("<row", from);
+       pos != std::string_view::npos && pos + 4 < limit;
+       pos = text.find("<row", pos + 1)) {
+    char next = text[pos + 4];
+    if (next == ' ' || next == '>' || next == '/' || next == '\t' ||
+        next == '\n' || next == '\r') {
+      return pos;
+    }
+  }
+  return std::string_view::npos;
+}
+
+} // namespace
+
+ParallelSheetParser::ParallelSheetParser(StringTableReader &stringTableReader,
+                                         ExcelRowBuilder rowBuilder,
+                                         SheetParserKind parser,
+                                         std::size_t threads,
+                                         std::size_t segmentSize)
+    : m_stringTableReader(stringTableReader),
+      m_rowBuilder(std::move(rowBuilder)), m_parser(parser),
+      m_segmentSize(segmentSize), m_pool(threads) {}
+
+bool ParallelSheetParser::feed(std::span<const std::byte> chunk) {
+  if (m_done || m_failed) {
+    return !m_failed;
+  }
+  m_pending.append(reinterpret_cast<const char *>(chunk.data()), chunk.size());
+
+  if (!m_inSheetData && !scanPrologue()) {
+    return !m_failed;
+  }
+  if (!m_done) {
+    cutSegments();
+  }
+  collect(false);
+  return !m_failed;
+}
+
+bool ParallelSheetParser::finish() {
+  if (!m_done) {
+    // Truncated sheet, the sequential parsers report it
+    m_failed = true;
+  }
+  collect(true);
+  return !m_failed;
+}
+
+void ParallelSheetParser::extractCompletedRows(RowBatch &rows) {
+  collect(false);
+  rows.clear();
+  std::swap(m_rows, rows);
+}
+
+RowBatch ParallelSheetParser::extractCompletedRows() {
+  RowBatch rows;
+  extractCompletedRows(rows);
+  return rows;
+}
+
+// Skips everything up to <sheetData>, once it is buffered. The part skipped
+// goes through a SheetScanner, which checks the encoding and that the tag
+// isn't inside a comment.
+bool ParallelSheetParser::scanPrologue() {
+  std::size_t open = m_pending.find("<sheetData");
+  std::size_t close =
+      open == std::string::npos ? open : m_pending.find('>', open);
+  if (close == std::string::npos) {
+    return false;
+  }
+
+  bool isEmpty = m_pending[close - 1] == '/';
+  std::string_view prologue(m_pending.data(), close + 1);
+  SheetScanner scanner(m_stringTableReader);
+  if (!scanner.feed(asBytes(prologue)) ||
+      (!isEmpty && !scanner.feed(asBytes(kSheetDataClose))) ||
+      !scanner.finish()) {
+    m_failed = true;
+    return false;
+  }
+
+  m_pending.erase(0, close + 1);
+  m_inSheetData = true;
+  if (isEmpty) {
+    m_pending.clear();
+    m_done = true;
+  }
+  return true;
+}
+
+void ParallelSheetParser::cutSegments() {
+  std::size_t end = m_pending.find(kSheetDataClose, m_endSearchFrom);
+  std::size_t limit = end == std::string::npos ? m_pending.size() : end;
+
+  std::size_t begin = 0;
+  while (limit - begin >= m_segmentSize && !m_failed) {
+    std::size_t cut = findRowStart(m_pending, begin + m_segmentSize, limit);
+    if (cut == std::string::npos) {
+      break;
+    }
+    submit(m_pending.substr(begin, cut - begin));
+    begin = cut;
+  }
+
+  if (end != std::string::npos) {
+    submit(m_pending.substr(begin, end - begin));
+    m_pending.clear();
+    m_done = true;
+    return;
+  }
+
+  m_pending.erase(0, begin);
+  // </sheetData> may straddle this chunk and the next
+  m_endSearchFrom = m_pending.size() >= kSheetDataClose.size()
+                        ? m_pending.size() - kSheetDataClose.size() + 1
+                        : 0;
+}
+
+void ParallelSheetParser::submit(std::string segment) {
+  if (m_failed) {
+    return;
+  }
+  // Bounds memory: wait for the oldest segment before queueing another
+  while (m_inFlight.size() >= 2 * m_pool.size() && !m_failed) {
+    collectFront();
+  }
+  m_inFlight.push_back(m_pool.submit(
+      [this, segment = std::move(segment)] { return parseSegment(segment); }));
+}
+
+void ParallelSheetParser::collect(bool wait) {
+  while (!m_inFlight.empty() && !m_failed) {
+    if (!wait && m_inFlight.front().wait_for(std::chrono::seconds(0)) !=
+                     std::future_status::ready) {
+      break;
+    }
+    collectFront();
+  }
+}
+
+void ParallelSheetParser::collectFront() {
+  SegmentRows rows = m_inFlight.front().get();
+  m_inFlight.pop_front();
+  if (!rows.has_value()) {
+    // Later segments are dropped, their rows can't be handed out anyway
+    m_failed = true;
+    m_inFlight.clear();
+    return;
+  }
+  m_rows.append(std::move(rows.value()));
+}
+
+ParallelSheetParser::SegmentRows
+ParallelSheetParser::parseSegment(std::string_view segment) const {
+  if (m_parser == SheetParserKind::Fast) {
+    SheetScanner scanner(m_stringTableReader, m_rowBuilder);
+    if (!scanner.feed(asBytes(kSheetDataOpen)) ||
+        !scanner.feed(asBytes(segment)) ||
+        !scanner.feed(asBytes(kSheetDataClose)) || !scanner.finish()) {
+      return std::nullopt;
+    }
+    return scanner.extractCompletedRows();
+  }
+
+  auto parser = createXmlParser();
+  XmlParser rowParser(m_stringTableReader, m_rowBuilder);
+  rowParser.attach(parser.get());
+  for (std::string_view part : {kSheetDataOpen, segment, kSheetDataClose}) {
+    // XmlParser stops expat itself after </sheetData>
+    if (XML_Parse(parser.get(), part.data(), static_cast<int>(part.size()),
+                  XML_FALSE) == XML_STATUS_ERROR &&
+        XML_GetErrorCode(parser.get()) != XML_ERROR_ABORTED) {
+      return std::nullopt;
+    }
+  }
+  if (!rowParser.isDone()) {
+    return std::nullopt;
+  }
+  return rowParser.extractCompletedRows();
+}
+
+#endif
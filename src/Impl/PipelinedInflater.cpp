@@ -0,0 +1,60 @@
+#include "PipelinedInflater.h"
+
+#ifdef EXCEL2CSV_THREADS
+
+PipelinedInflater::PipelinedInflater(ZipEntryReader &reader,
+                                     std::size_t chunkSize)
+    : m_reader(reader), m_chunkSize(chunkSize),
+      m_producer(&PipelinedInflater::produce, this) {}
+
+PipelinedInflater::~PipelinedInflater() {
+  m_ring.close();
+  m_producer.join();
+}
+
+void PipelinedInflater::produce() {
+  while (Chunk *chunk = m_ring.acquireWrite()) {
+    try {
+      // Buffers are only allocated on their first trip around the ring
+      chunk->buffer.resize(m_chunkSize);
+      chunk->size = m_reader.read(chunk->buffer);
+      chunk->last = chunk->size == 0;
+    } catch (...) {
+      chunk->error = std::current_exception();
+      chunk->size = 0;
+      chunk->last = true;
+    }
+
+    bool last = chunk->last;
+    m_ring.commitWrite();
+    if (last) {
+      return;
+    }
+  }
+}
+
+std::span<const std::byte> PipelinedInflater::next() {
+  if (m_holdingChunk) {
+    m_ring.releaseRead();
+    m_holdingChunk = false;
+  }
+  if (m_done) {
+    return {};
+  }
+
+  Chunk *chunk = m_ring.acquireRead();
+  if (chunk->last) {
+    m_done = true;
+    std::exception_ptr error = chunk->error;
+    m_ring.releaseRead();
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    return {};
+  }
+
+  m_holdingChunk = true;
+  return {chunk->buffer.data(), chunk->size};
+}
+
+#endif
@@ -0,0 +1,144 @@
+#include "RecordBatch.h"
+
+#include <algorithm>
+#include <format>
+#include <limits>
+#include <stdexcept>
+
+#include "NumberCodec.h"
+#include "StringTableReader.h"
+
+using Type = RecordBatch::Column::Type;
+
+static Type typeOf(const ExcelCell &cell) {
+  switch (cell.kind()) {
+  case ExcelCell::Kind::Number:
+  case ExcelCell::Kind::NumberText:
+    return Type::Number;
+  case ExcelCell::Kind::Boolean:
+    return Type::Boolean;
+  case ExcelCell::Kind::String:
+    // Blank cells are empty strings
+    return cell.asString().empty() ? Type::Null : Type::String;
+  case ExcelCell::Kind::SharedString:
+    break;
+  }
+  return Type::String;
+}
+
+void RecordBatch::Column::fill(std::span<const std::span<const ExcelCell>> rows,
+                               std::size_t column,
+                               const StringTableReader &sharedStrings) {
+  m_size = rows.size();
+  auto cellAt = [&](std::size_t row) {
+    auto cells = rows[row];
+    return column < cells.size() ? cells[column] : ExcelCell();
+  };
+
+  for (std::size_t row = 0; row < m_size; ++row) {
+    Type type = typeOf(cellAt(row));
+    if (type == Type::Null || type == m_type) {
+      continue;
+    }
+    if (m_type != Type::Null) {
+      m_type = Type::String;
+      break;
+    }
+    m_type = type;
+  }
+
+  m_validity.assign((m_size + 63) / 64, 0);
+  auto setValid = [this](std::size_t row) {
+    m_validity[row / 64] |= std::uint64_t(1) << (row % 64);
+  };
+
+  switch (m_type) {
+  case Type::Null:
+    break;
+  case Type::Number:
+    m_numbers.assign(m_size, 0);
+    for (std::size_t row = 0; row < m_size; ++row) {
+      ExcelCell cell = cellAt(row);
+      if (cell.kind() == ExcelCell::Kind::Number) {
+        m_numbers[row] = cell.asNumber();
+        setValid(row);
+      } else if (cell.kind() == ExcelCell::Kind::NumberText) {
+        // Out of range texts stay null
+        if (auto number = parseNumber(cell.asNumberText())) {
+          m_numbers[row] = number.value();
+          setValid(row);
+        }
+      }
+    }
+    break;
+  case Type::Boolean:
+    m_booleans.assign(m_size, 0);
+    for (std::size_t row = 0; row < m_size; ++row) {
+      ExcelCell cell = cellAt(row);
+      if (cell.kind() == ExcelCell::Kind::Boolean) {
+        m_booleans[row] = cell.asBoolean();
+        setValid(row);
+      }
+    }
+    break;
+  case Type::String:
+    m_offsets.reserve(m_size + 1);
+    m_offsets.push_back(0);
+    for (std::size_t row = 0; row < m_size; ++row) {
+      ExcelCell cell = cellAt(row);
+      switch (cell.kind()) {
+      case ExcelCell::Kind::String:
+        m_bytes += cell.asString();
+        break;
+      case ExcelCell::Kind::SharedString:
+        m_bytes += sharedStrings.getStringEntry(cell.sharedStringIndex());
+        break;
+      case ExcelCell::Kind::Number:
+        appendNumber(m_bytes, cell.asNumber());
+        break;
+      case ExcelCell::Kind::NumberText:
+        m_bytes += cell.asNumberText();
+        break;
+      case ExcelCell::Kind::Boolean:
+        m_bytes += cell.asBoolean() ? "true" : "false";
+        break;
+      }
+      if (typeOf(cell) != Type::Null) {
+        setValid(row);
+      }
+      if (m_bytes.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::length_error(std::format(
+            "Text of column {} is over 4 GiB, read fewer rows per batch",
+            column));
+      }
+      m_offsets.push_back(static_cast<std::uint32_t>(m_bytes.size()));
+    }
+    break;
+  }
+}
+
+RecordBatch
+RecordBatch::fromRows(std::span<const std::span<const ExcelCell>> rows,
+                      const StringTableReader &sharedStrings) {
+  RecordBatch batch;
+  batch.m_rowCount = rows.size();
+  std::size_t width = 0;
+  for (auto row : rows) {
+    width = std::max(width, row.size());
+  }
+  batch.m_columns.resize(width);
+  for (std::size_t column = 0; column < width; ++column) {
+    batch.m_columns[column].fill(rows, column, sharedStrings);
+  }
+  return batch;
+}
+
+RecordBatch RecordBatch::fromRows(const RowBatch &rows,
+                                  const StringTableReader &sharedStrings) {
+  std::vector<std::span<const ExcelCell>> cells;
+  cells.reserve(rows.size());
+  for (auto row : rows) {
+    cells.push_back(row);
+  }
+  return fromRows(cells, sharedStrings);
+}
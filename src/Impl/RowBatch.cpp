@@ -0,0 +1,98 @@
+#include "RowBatch.h"
+#include "StringTableReader.h"
+
+#include <cassert>
+#include <utility>
+
+RowBatch::RowBatch(const RowBatch &other) : m_rowEnds(other.m_rowEnds) {
+  m_cells.reserve(other.m_cells.size());
+  for (const auto &cell : other.m_cells) {
+    m_cells.push_back(own(cell));
+  }
+}
+
+RowBatch &RowBatch::operator=(const RowBatch &other) {
+  if (this != &other) {
+    RowBatch copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+ExcelCell RowBatch::own(ExcelCell cell) {
+  if (cell.kind() == ExcelCell::Kind::String) {
+    return ExcelCell::string(store(cell.asString()));
+  }
+  if (cell.kind() == ExcelCell::Kind::NumberText) {
+    return ExcelCell::numberText(store(cell.asNumberText()));
+  }
+  return cell;
+}
+
+void RowBatch::resetOpenRow(std::size_t width) {
+  m_cells.resize(openRowStart());
+  m_cells.resize(m_cells.size() + width);
+}
+
+void RowBatch::clear() {
+  m_cells.clear();
+  m_rowEnds.clear();
+  m_strings.reset();
+}
+
+void RowBatch::takeCompleted(RowBatch &into) {
+  into.clear();
+  if (empty()) {
+    return;
+  }
+  std::swap(*this, into);
+
+  std::size_t openStart = into.openRowStart();
+  for (std::size_t i = openStart; i < into.m_cells.size(); ++i) {
+    push(into.m_cells[i]);
+  }
+  into.m_cells.resize(openStart);
+}
+
+RowBatch RowBatch::takeCompleted() {
+  RowBatch completed;
+  takeCompleted(completed);
+  return completed;
+}
+
+void RowBatch::append(RowBatch &&other) {
+  assert(openRowStart() == m_cells.size());
+  std::size_t base = m_cells.size();
+  m_cells.insert(m_cells.end(), other.m_cells.begin(),
+                 other.m_cells.begin() + other.openRowStart());
+  for (std::size_t rowEnd : other.m_rowEnds) {
+    m_rowEnds.push_back(base + rowEnd);
+  }
+  m_strings.adopt(std::move(other.m_strings));
+  other.clear();
+}
+
+std::vector<std::vector<ExcelValue>>
+RowBatch::toValues(const StringTableReader *sharedStrings) const {
+  std::vector<std::vector<ExcelValue>> rows;
+  rows.reserve(size());
+  for (auto row : *this) {
+    auto &values = rows.emplace_back();
+    values.reserve(row.size());
+    for (const auto &cell : row) {
+      values.push_back(sharedStrings != nullptr
+                           ? toExcelValue(cell, *sharedStrings)
+                           : toExcelValue(cell));
+    }
+  }
+  return rows;
+}
+
+ExcelValue toExcelValue(const ExcelCell &cell,
+                        const StringTableReader &sharedStrings) {
+  if (cell.kind() == ExcelCell::Kind::SharedString) {
+    return std::string(
+        sharedStrings.getStringEntry(cell.sharedStringIndex()));
+  }
+  return toExcelValue(cell);
+}
@@ -0,0 +1,525 @@
+#include "SheetScanner.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// Longest reference we decode, "&#x10FFFF;"
+constexpr std::ptrdiff_t kMaxReferenceLength = 12;
+
+// First byte in [p, end) equal to any of `Needles`, 16 bytes at a time.
+template <char... Needles>
+const char *findFirstOf(const char *p, const char *end) {
+#if defined(__SSE2__)
+  while (end - p >= 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i hits = _mm_setzero_si128();
+    ((hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(Needles)))),
+     ...);
+    int mask = _mm_movemask_epi8(hits);
+    if (mask != 0) {
+      return p + __builtin_ctz(static_cast<unsigned>(mask));
+    }
+    p += 16;
+  }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  while (end - p >= 16) {
+    uint8x16_t block = vld1q_u8(reinterpret_cast<const std::uint8_t *>(p));
+    uint8x16_t hits = vdupq_n_u8(0);
+    ((hits = vorrq_u8(hits, vceqq_u8(block, vdupq_n_u8(Needles)))), ...);
+    if (vmaxvq_u8(hits) != 0) {
+      // The scalar loop below pinpoints the hit within this block
+      break;
+    }
+    p += 16;
+  }
+#endif
+  for (; p < end; ++p) {
+    if (((*p == Needles) || ...)) {
+      return p;
+    }
+  }
+  return end;
+}
+
+bool isXmlSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+void appendUtf8(std::string &out, std::uint32_t codePoint) {
+  if (codePoint < 0x80) {
+    out += static_cast<char>(codePoint);
+  } else if (codePoint < 0x800) {
+    out += static_cast<char>(0xC0 | (codePoint >> 6));
+    out += static_cast<char>(0x80 | (codePoint & 0x3F));
+  } else if (codePoint < 0x10000) {
+    out += static_cast<char>(0xE0 | (codePoint >> 12));
+    out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (codePoint & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | (codePoint >> 18));
+    out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (codePoint & 0x3F));
+  }
+}
+
+} // namespace
+
+bool SheetScanner::feed(std::span<const std::byte> chunk) {
+  const char *begin = reinterpret_cast<const char *>(chunk.data());
+  const char *end = begin + chunk.size();
+
+  if (m_state == State::Done) {
+    // Nothing after </sheetData> or the last wanted row matters
+    m_pending.clear();
+    return !m_unsupported;
+  }
+
+  if (!m_sawInput && begin != end) {
+    m_sawInput = true;
+    // UTF-16 input, left to expat
+    if (end - begin >= 2 && (begin[0] == '\0' || begin[1] == '\0' ||
+                             static_cast<unsigned char>(begin[0]) >= 0xFE)) {
+      m_unsupported = true;
+      return false;
+    }
+  }
+
+  // Complete the markup split across the previous boundary first, taking only
+  // as much of this chunk as needed so the rest is scanned in place.
+  while (!m_pending.empty() && begin != end && m_state != State::Done) {
+    const char *close = findFirstOf<'>'>(begin, end);
+    const char *take = close == end ? end : close + 1;
+    m_pending.append(begin, take);
+    begin = take;
+
+    std::size_t consumed = scan(m_pending.data(),
+                                m_pending.data() + m_pending.size());
+    m_pending.erase(0, consumed);
+    if (m_unsupported) {
+      return false;
+    }
+  }
+
+  if (m_pending.empty() && m_state != State::Done) {
+    std::size_t consumed = scan(begin, end);
+    m_pending.assign(begin + consumed, end);
+  }
+  if (m_state == State::Done) {
+    m_pending.clear();
+  }
+  return !m_unsupported;
+}
+
+bool SheetScanner::finish() {
+  return !m_unsupported && m_state == State::Done && m_pending.empty();
+}
+
+std::size_t SheetScanner::scan(const char *begin, const char *end) {
+  const char *p = begin;
+
+  while (p < end && !m_unsupported && m_state != State::Done) {
+    if (m_state == State::InValue || m_state == State::InInlineText ||
+        m_state == State::InFormula) {
+      const char *stop = findFirstOf<'<', '&', '\r'>(p, end);
+      if (collectsText()) {
+        m_cellValue.append(p, stop);
+      }
+      p = stop;
+      if (p == end) {
+        break;
+      }
+
+      if (*p == '&') {
+        const char *next = scanReference(p, end);
+        if (next == nullptr) {
+          break;
+        }
+        p = next;
+        continue;
+      }
+      if (*p == '\r') {
+        // Line ends are normalised to \n, same as expat does
+        if (p + 1 == end) {
+          break;
+        }
+        if (collectsText()) {
+          m_cellValue += '\n';
+        }
+        p += p[1] == '\n' ? 2 : 1;
+        continue;
+      }
+    } else {
+      // Text between elements carries nothing we need
+      p = findFirstOf<'<'>(p, end);
+      if (p == end) {
+        break;
+      }
+    }
+
+    const char *next = scanMarkup(p, end);
+    if (next == nullptr) {
+      break;
+    }
+    p = next;
+  }
+
+  return p - begin;
+}
+
+// Decodes the entity or character reference at `p` into the current value.
+// Returns nullptr if it runs past `end` or isn't supported.
+const char *SheetScanner::scanReference(const char *p, const char *end) {
+  const char *limit = end - p > kMaxReferenceLength ? p + kMaxReferenceLength
+                                                    : end;
+  const char *semicolon = findFirstOf<';'>(p, limit);
+  if (semicolon == limit) {
+    m_unsupported = limit != end;
+    return nullptr;
+  }
+
+  std::string_view name(p + 1, semicolon - p - 1);
+  char replacement = 0;
+  if (name == "amp") {
+    replacement = '&';
+  } else if (name == "lt") {
+    replacement = '<';
+  } else if (name == "gt") {
+    replacement = '>';
+  } else if (name == "quot") {
+    replacement = '"';
+  } else if (name == "apos") {
+    replacement = '\'';
+  } else if (name.size() >= 2 && name[0] == '#') {
+    bool hex = name[1] == 'x';
+    std::string_view digits = name.substr(hex ? 2 : 1);
+    std::uint32_t codePoint = 0;
+    for (char c : digits) {
+      std::uint32_t digit;
+      if (c >= '0' && c <= '9') {
+        digit = c - '0';
+      } else if (hex && c >= 'a' && c <= 'f') {
+        digit = c - 'a' + 10;
+      } else if (hex && c >= 'A' && c <= 'F') {
+        digit = c - 'A' + 10;
+      } else {
+        m_unsupported = true;
+        return nullptr;
+      }
+      codePoint = codePoint * (hex ? 16 : 10) + digit;
+    }
+    if (digits.empty() || codePoint == 0 || codePoint > 0x10FFFF) {
+      m_unsupported = true;
+      return nullptr;
+    }
+    if (collectsText()) {
+      appendUtf8(m_cellValue, codePoint);
+    }
+    return semicolon + 1;
+  } else {
+    m_unsupported = true;
+    return nullptr;
+  }
+
+  if (collectsText()) {
+    m_cellValue += replacement;
+  }
+  return semicolon + 1;
+}
+
+// Handles the markup starting with the '<' at `p`. Returns the position right
+// after it, or nullptr if it runs past `end` or isn't supported.
+const char *SheetScanner::scanMarkup(const char *p, const char *end) {
+  std::string_view rest(p, end - p);
+  if (rest.size() < 4) {
+    return nullptr;
+  }
+
+  if (rest[1] == '!') {
+    if (!rest.starts_with("<!--")) {
+      // CDATA sections and DTDs are left to expat
+      m_unsupported = true;
+      return nullptr;
+    }
+    std::size_t close = rest.find("-->", 4);
+    return close == std::string_view::npos ? nullptr : p + close + 3;
+  }
+
+  if (rest[1] == '?') {
+    std::size_t close = rest.find("?>", 2);
+    if (close == std::string_view::npos) {
+      return nullptr;
+    }
+    if (m_state == State::BeforeSheetData) {
+      checkDeclaration(rest.substr(0, close));
+    }
+    return m_unsupported ? nullptr : p + close + 2;
+  }
+
+  // Find the closing '>', stepping over quoted attribute values
+  const char *close = p + 1;
+  while (true) {
+    close = findFirstOf<'>', '"', '\''>(close, end);
+    if (close == end) {
+      return nullptr;
+    }
+    if (*close == '>') {
+      break;
+    }
+    const char *quoteEnd = *close == '"' ? findFirstOf<'"'>(close + 1, end)
+                                         : findFirstOf<'\''>(close + 1, end);
+    if (quoteEnd == end) {
+      return nullptr;
+    }
+    close = quoteEnd + 1;
+  }
+
+  bool isEnd = p[1] == '/';
+  const char *nameBegin = p + 1 + (isEnd ? 1 : 0);
+  const char *bodyEnd = close;
+  bool isEmpty = !isEnd && close[-1] == '/';
+  if (isEmpty) {
+    --bodyEnd;
+  }
+  const char *nameEnd = nameBegin;
+  while (nameEnd < bodyEnd && !isXmlSpace(*nameEnd)) {
+    ++nameEnd;
+  }
+
+  onTag(classifyTag(std::string_view(nameBegin, nameEnd - nameBegin)),
+        std::string_view(nameEnd, bodyEnd - nameEnd), isEnd, isEmpty);
+  return m_unsupported ? nullptr : close + 1;
+}
+
+void SheetScanner::checkDeclaration(std::string_view declaration) {
+  if (!declaration.starts_with("<?xml ")) {
+    return;
+  }
+  std::size_t encoding = declaration.find("encoding=");
+  if (encoding == std::string_view::npos) {
+    return;
+  }
+  std::string_view value = declaration.substr(encoding + 10);
+  value = value.substr(0, value.find_first_of("\"'"));
+
+  std::string lowered(value);
+  std::transform(lowered.begin(), lowered.end(), lowered.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  if (lowered != "utf-8" && lowered != "utf8") {
+    m_unsupported = true;
+  }
+}
+
+void SheetScanner::onTag(XmlTag tag, std::string_view attributes,
+                         bool isEnd, bool isEmpty) {
+  switch (m_state) {
+  case State::BeforeSheetData:
+    if (!isEnd && tag == XmlTag::SheetData) {
+      m_state = isEmpty ? State::Done : State::InSheetData;
+    }
+    return;
+
+  case State::InSheetData:
+    if (isEnd && tag == XmlTag::SheetData) {
+      m_state = State::Done;
+      return;
+    }
+    if (!isEnd && tag == XmlTag::Row) {
+      if (isEmpty) {
+        completeRow();
+      } else {
+        m_state = State::InRow;
+      }
+      return;
+    }
+    break;
+
+  case State::InRow:
+    if (isEnd && tag == XmlTag::Row) {
+      m_state = State::InSheetData;
+      completeRow();
+      return;
+    }
+    if (!isEnd && tag == XmlTag::C) {
+      beginCell(attributes);
+      if (isEmpty) {
+        endCell();
+      } else {
+        m_state = State::InCell;
+      }
+      return;
+    }
+    break;
+
+  case State::InCell:
+    if (isEnd) {
+      if (tag == XmlTag::C) {
+        endCell();
+        m_state = State::InRow;
+        return;
+      }
+      break;
+    }
+    if (tag == XmlTag::V) {
+      m_cellValue.clear();
+      if (isEmpty) {
+        pushCellValue();
+      } else {
+        m_state = State::InValue;
+      }
+      return;
+    }
+    if (tag == XmlTag::F) {
+      if (!isEmpty) {
+        m_state = State::InFormula;
+      }
+      return;
+    }
+    if (tag == XmlTag::Is) {
+      m_cellValue.clear();
+      if (isEmpty) {
+        m_currentRowBuilder.push(ExcelCell());
+        m_cellHasValue = true;
+      } else {
+        m_state = State::InInlineString;
+      }
+      return;
+    }
+    break;
+
+  case State::InValue:
+    if (isEnd && tag == XmlTag::V) {
+      pushCellValue();
+      m_state = State::InCell;
+      return;
+    }
+    break;
+
+  case State::InFormula:
+    if (isEnd && tag == XmlTag::F) {
+      m_state = State::InCell;
+      return;
+    }
+    break;
+
+  case State::InInlineString:
+    // Rich text runs wrap their <t> in <r>/<rPr>, only the text matters
+    if (isEnd && tag == XmlTag::Is) {
+      if (m_cellSelected) {
+        m_currentRowBuilder.push(ExcelCell::string(m_cellValue));
+      }
+      m_cellHasValue = true;
+      m_state = State::InCell;
+    } else if (!isEnd && !isEmpty && tag == XmlTag::T) {
+      m_state = State::InInlineText;
+    }
+    return;
+
+  case State::InInlineText:
+    if (isEnd && tag == XmlTag::T) {
+      m_state = State::InInlineString;
+      return;
+    }
+    break;
+
+  case State::Done:
+    return;
+  }
+
+  m_unsupported = true;
+}
+
+void SheetScanner::beginCell(std::string_view attributes) {
+  m_cellType = CellType::Number;
+  m_cellHasValue = false;
+  bool needsColumn = m_currentRowBuilder.needsColumns();
+  bool needsStyle = m_currentRowBuilder.needsStyles();
+  std::optional<std::uint32_t> column;
+  std::uint32_t style = 0;
+
+  std::size_t i = 0;
+  while (i < attributes.size()) {
+    while (i < attributes.size() && isXmlSpace(attributes[i])) {
+      ++i;
+    }
+    std::size_t equals = attributes.find('=', i);
+    if (equals == std::string_view::npos) {
+      break;
+    }
+    std::string_view name = attributes.substr(i, equals - i);
+    while (!name.empty() && isXmlSpace(name.back())) {
+      name.remove_suffix(1);
+    }
+
+    std::size_t quote = attributes.find_first_of("\"'", equals);
+    if (quote == std::string_view::npos) {
+      m_unsupported = true;
+      return;
+    }
+    std::size_t valueEnd = attributes.find(attributes[quote], quote + 1);
+    if (valueEnd == std::string_view::npos) {
+      m_unsupported = true;
+      return;
+    }
+    std::string_view value = attributes.substr(quote + 1, valueEnd - quote - 1);
+
+    if (name == "t") {
+      if (value.find('&') != std::string_view::npos) {
+        m_unsupported = true;
+        return;
+      }
+      m_cellType = parseCellType(value);
+    } else if (needsColumn && name == "r") {
+      column = parseColumnReference(value);
+    } else if (needsStyle && name == "s") {
+      auto [end, error] =
+          std::from_chars(value.data(), value.data() + value.size(), style);
+      if (error != std::errc() || end != value.data() + value.size()) {
+        // Left to expat, which reads the digits out of any text
+        m_unsupported = true;
+        return;
+      }
+    }
+    i = valueEnd + 1;
+  }
+  m_cellSelected = m_currentRowBuilder.beginCell(column, style);
+}
+
+void SheetScanner::completeRow() {
+  m_currentRowBuilder.seal();
+  m_currentRowBuilder.reset();
+  if (m_currentRowBuilder.isExhausted()) {
+    m_state = State::Done;
+  }
+}
+
+void SheetScanner::pushCellValue() {
+  if (m_cellSelected) {
+    m_currentRowBuilder.push(
+        createExcelCell(m_stringTableReader, m_cellType, m_cellValue,
+                        m_currentRowBuilder.keepsNumberText()));
+  }
+  m_cellHasValue = true;
+}
+
+void SheetScanner::endCell() {
+  if (!m_cellHasValue) {
+    // Cell without a value, e.g. a styled blank <c r="B2" s="1"/>
+    m_currentRowBuilder.push(ExcelCell());
+  }
+}
@@ -0,0 +1,109 @@
+#include "SpillFile.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+
+// Writes go out in blocks of this size
+constexpr std::size_t kWriteBufferSize = 1024 * 1024;
+
+SpillFile::SpillFile() {
+  std::string path =
+      (std::filesystem::temp_directory_path() / "excel2csv-spill-XXXXXX")
+          .string();
+  m_fd = mkstemp(path.data());
+  if (m_fd < 0) {
+    throw std::runtime_error(std::format(
+        "Failed to create a spill file in '{}': {}",
+        std::filesystem::temp_directory_path().string(), strerror(errno)));
+  }
+  unlink(path.c_str());
+  m_pending.reserve(kWriteBufferSize);
+}
+
+SpillFile::SpillFile(SpillFile &&other) noexcept
+    : m_fd(std::exchange(other.m_fd, -1)),
+      m_pending(std::move(other.m_pending)),
+      m_size(std::exchange(other.m_size, 0)),
+      m_mapping(std::exchange(other.m_mapping, nullptr)),
+      m_mappedSize(std::exchange(other.m_mappedSize, 0)) {}
+
+SpillFile &SpillFile::operator=(SpillFile &&other) noexcept {
+  if (this != &other) {
+    release();
+    m_fd = std::exchange(other.m_fd, -1);
+    m_pending = std::move(other.m_pending);
+    m_size = std::exchange(other.m_size, 0);
+    m_mapping = std::exchange(other.m_mapping, nullptr);
+    m_mappedSize = std::exchange(other.m_mappedSize, 0);
+  }
+  return *this;
+}
+
+SpillFile::~SpillFile() { release(); }
+
+void SpillFile::release() {
+  if (m_mapping != nullptr) {
+    munmap(const_cast<char *>(m_mapping), m_mappedSize);
+    m_mapping = nullptr;
+    m_mappedSize = 0;
+  }
+  if (m_fd >= 0) {
+    close(m_fd);
+    m_fd = -1;
+  }
+}
+
+void SpillFile::flush() {
+  const char *data = m_pending.data();
+  std::size_t left = m_pending.size();
+  while (left > 0) {
+    ssize_t written = write(m_fd, data, left);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      throw std::runtime_error(
+          std::format("Failed to write the spill file: {}", strerror(errno)));
+    }
+    data += written;
+    left -= static_cast<std::size_t>(written);
+  }
+  m_pending.clear();
+}
+
+std::uint64_t SpillFile::append(std::string_view bytes) {
+  std::uint64_t offset = m_size;
+  if (m_pending.size() + bytes.size() > kWriteBufferSize) {
+    flush();
+  }
+  m_pending += bytes;
+  m_size += bytes.size();
+  return offset;
+}
+
+void SpillFile::map() {
+  flush();
+  if (m_mapping != nullptr) {
+    munmap(const_cast<char *>(m_mapping), m_mappedSize);
+    m_mapping = nullptr;
+    m_mappedSize = 0;
+  }
+  if (m_size == 0) {
+    return;
+  }
+  void *mapping = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error(
+        std::format("Failed to map the spill file: {}", strerror(errno)));
+  }
+  m_mapping = static_cast<const char *>(mapping);
+  m_mappedSize = m_size;
+}
@@ -1,28 +1,34 @@
 #include "StringTableReader.h"
 #include "Utils.h"
+#include "XmlParser.h"
+#include "XmlTag.h"
 
-#include <cstring>
 #include <expat.h>
+#include <algorithm>
+#include <memory>
 #include <stdexcept>
+#include <utility>
 
 void XMLCALL StringTableReader::startElement(void *userData, const char *name,
                                              const char **atts) {
   auto *reader = static_cast<StringTableReader *>(userData);
-  if (strcmp(name, "si") == 0) {
+  XmlTag tag = classifyTag(name);
+  if (tag == XmlTag::Si) {
     reader->current_string.clear();
     reader->in_string_item = true;
-  } else if (strcmp(name, "t") == 0 && reader->in_string_item) {
+  } else if (tag == XmlTag::T && reader->in_string_item) {
     reader->in_text_element = true;
   }
 }
 
 void XMLCALL StringTableReader::endElement(void *userData, const char *name) {
   auto *reader = static_cast<StringTableReader *>(userData);
-  if (strcmp(name, "si") == 0) {
+  XmlTag tag = classifyTag(name);
+  if (tag == XmlTag::Si) {
     // End of string item - add to string table
-    reader->string_table.push_back(reader->current_string);
+    reader->addString(reader->current_string);
     reader->in_string_item = false;
-  } else if (strcmp(name, "t") == 0) {
+  } else if (tag == XmlTag::T) {
     // End of text element
     reader->in_text_element = false;
   }
@@ -36,34 +42,156 @@ void XMLCALL StringTableReader::charDataHandler(void *userData, const char *s,
   }
 }
 
-void StringTableReader::collect(unzFile excelFileRef) {
-  auto parser = XML_ParserCreate(nullptr);
-  if (!parser) {
-    throw new std::runtime_error("Failed to allocate parser");
+void StringTableReader::reserve(std::uint64_t xmlSize) {
+  // UTF-8 text is never longer than the XML it's decoded from, and every item
+  // takes at least "<si/>". Longer tables spill, like past the budget
+  std::size_t bytes = std::min<std::uint64_t>(xmlSize, memory_budget);
+  std::size_t strings =
+      std::min<std::uint64_t>(xmlSize / 5, memory_budget / 8) + 1;
+  string_pool = StableArray<char>(bytes);
+  string_offsets = StableArray<std::uint64_t>(strings + 1);
+  string_offsets.push_back(0);
+  string_quoting = StableArray<CsvQuoting>(strings);
+}
+
+void StringTableReader::addString(const std::string &text) {
+  CsvQuoting quoting = csvQuotingOf(text);
+  std::size_t cost = sizeof(std::uint64_t) + sizeof(CsvQuoting) + text.size();
+  if (!spill_file.has_value() && memory_used + cost <= memory_budget &&
+      text.size() <= string_pool.capacity() - string_pool.size() &&
+      string_offsets.size() < string_offsets.capacity()) {
+    string_quoting.push_back(quoting);
+    string_pool.append(text.data(), text.size());
+    string_offsets.push_back(string_pool.size());
+    memory_used += cost;
+#ifdef EXCEL2CSV_THREADS
+    if (publishing != nullptr) {
+      publishing->ready.store(inMemoryCount(), std::memory_order_release);
+    }
+#endif
+    return;
+  }
+  // Once one string spilled the rest follows, keeping indices contiguous
+  if (!spill_file.has_value()) {
+    spill_file.emplace();
+    spill_offsets.push_back(0);
+  }
+  spill_file->append(text);
+  spill_offsets.push_back(spill_file->size());
+  spill_quoting.push_back(quoting);
+}
+
+void StringTableReader::collect(const ZipArchive &excelArchive,
+                                ZipReadOptions zipOptions) {
+  std::vector<std::byte> buffer;
+  collect(excelArchive, buffer, zipOptions);
+}
+
+void StringTableReader::collect(const ZipArchive &excelArchive,
+                                std::vector<std::byte> &buffer,
+                                ZipReadOptions zipOptions) {
+  if (lazy) {
+    auto strings = std::make_unique<LazyStringTable>(memory_budget);
+    if (strings->collect(excelArchive, buffer, zipOptions)) {
+      lazy_strings = std::move(strings);
+      return;
+    }
   }
 
-  XML_SetUserData(parser, this);
-  XML_SetElementHandler(parser, StringTableReader::startElement,
+  if (const ZipEntry *entry = excelArchive.find("xl/sharedStrings.xml")) {
+    reserve(entry->uncompressedSize);
+  }
+  auto parser = createXmlParser();
+  XML_SetUserData(parser.get(), this);
+  XML_SetElementHandler(parser.get(), StringTableReader::startElement,
                         StringTableReader::endElement);
-  XML_SetCharacterDataHandler(parser, StringTableReader::charDataHandler);
-
-  for (auto &chunk :
-       ZipUtils::readFileChunked(excelFileRef, "xl/sharedStrings.xml")) {
-    auto start = reinterpret_cast<char *>(chunk.data());
-    int end = chunk.size();
-    if (XML_Parse(parser, start, end, XML_FALSE) == XML_FALSE) {
-      XML_ParserFree(parser);
-      throw MalformedExcelFileException(
-          "Error while reading xl/sharedStrings.xml");
+  XML_SetCharacterDataHandler(parser.get(),
+                              StringTableReader::charDataHandler);
+
+  // The handlers fill the string table while the entry is parsed
+  for ([[maybe_unused]] auto parsedBytes :
+       parseZipEntry(parser.get(), excelArchive, "xl/sharedStrings.xml",
+                     buffer, zipOptions)) {
+#ifdef EXCEL2CSV_THREADS
+    if (publishing != nullptr) {
+      // Waking waiters once per chunk rather than per string
+      publishing->ready.notify_all();
+      if (publishing->stop.load(std::memory_order_relaxed)) {
+        return;
+      }
     }
+#endif
+  }
+  if (spill_file.has_value()) {
+    spill_file->map();
+  }
+}
+
+#ifdef EXCEL2CSV_THREADS
+StringTableReader::Collection::~Collection() {
+  if (thread.joinable()) {
+    stop.store(true, std::memory_order_relaxed);
+    thread.join();
   }
-  XML_ParserFree(parser);
 }
 
-std::optional<std::string>
-StringTableReader::getStringEntry(std::size_t stringIndex) {
-  if (stringIndex >= string_table.size()) {
+void StringTableReader::collectInBackground(ZipArchive excelArchive,
+                                            ZipReadOptions zipOptions) {
+  if (lazy) {
+    collect(excelArchive, zipOptions);
+    return;
+  }
+  collection->ready.store(0, std::memory_order_relaxed);
+  collection->thread = std::thread([this, target = collection.get(),
+                                    archive = std::move(excelArchive),
+                                    zipOptions]() {
+    publishing = target;
+    try {
+      collect(archive, zipOptions);
+    } catch (...) {
+      target->error = std::current_exception();
+    }
+    publishing = nullptr;
+    target->ready.store(target->error ? kFailed : kCollected,
+                        std::memory_order_release);
+    target->ready.notify_all();
+  });
+}
+
+bool StringTableReader::waitForString(std::size_t stringIndex) const {
+  std::size_t ready = collection->ready.load(std::memory_order_acquire);
+  while (ready < kFailed && ready <= stringIndex) {
+    collection->ready.wait(ready, std::memory_order_acquire);
+    ready = collection->ready.load(std::memory_order_acquire);
+  }
+  if (ready == kFailed) {
+    std::rethrow_exception(collection->error);
+  }
+  return ready != kCollected;
+}
+#endif
+
+StringTableReader::~StringTableReader() {
+#ifdef EXCEL2CSV_THREADS
+  collection.reset();
+#endif
+}
+
+void StringTableReader::finishCollecting() {
+#ifdef EXCEL2CSV_THREADS
+  if (collection->thread.joinable()) {
+    collection->thread.join();
+  }
+  if (collection->error) {
+    std::rethrow_exception(collection->error);
+  }
+#endif
+}
+
+std::optional<std::string_view>
+StringTableReader::viewStringEntry(std::size_t stringIndex) const {
+  if (!hasStringEntry(stringIndex)) {
     return std::nullopt;
   }
-  return string_table[stringIndex];
-}
\ No newline at end of file
+  return getStringEntry(stringIndex);
+}
@@ -0,0 +1,74 @@
+#include "StylesReader.h"
+#include "Utils.h"
+#include "XmlParser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <expat.h>
+
+void XMLCALL StylesReader::startElement(void *userData, const char *name,
+                                        const char **atts) {
+  auto *reader = static_cast<StylesReader *>(userData);
+  if (strcmp(name, "numFmt") == 0) {
+    std::uint32_t id = 0;
+    const char *code = "";
+    for (int i = 0; atts[i]; i += 2) {
+      if (strcmp(atts[i], "numFmtId") == 0) {
+        id = static_cast<std::uint32_t>(stringToNumber(atts[i + 1]));
+      } else if (strcmp(atts[i], "formatCode") == 0) {
+        code = atts[i + 1];
+      }
+    }
+    reader->m_formatCodes[id] = code;
+  } else if (strcmp(name, "cellXfs") == 0) {
+    reader->m_inCellXfs = true;
+  } else if (strcmp(name, "xf") == 0 && reader->m_inCellXfs) {
+    std::uint32_t id = 0;
+    for (int i = 0; atts[i]; i += 2) {
+      if (strcmp(atts[i], "numFmtId") == 0) {
+        id = static_cast<std::uint32_t>(stringToNumber(atts[i + 1]));
+      }
+    }
+    // Custom formats may reuse a built-in's id
+    auto code = reader->m_formatCodes.find(id);
+    reader->m_styleFormats.push_back(reader->addFormat(
+        code != reader->m_formatCodes.end()
+            ? NumberFormat::compile(code->second)
+            : NumberFormat::builtIn(id)));
+  }
+}
+
+void XMLCALL StylesReader::endElement(void *userData, const char *name) {
+  auto *reader = static_cast<StylesReader *>(userData);
+  if (strcmp(name, "cellXfs") == 0) {
+    reader->m_inCellXfs = false;
+  }
+}
+
+std::uint32_t StylesReader::addFormat(NumberFormat format) {
+  auto match = std::find(m_formats.begin(), m_formats.end(), format);
+  if (match == m_formats.end()) {
+    match = m_formats.insert(match, format);
+  }
+  return static_cast<std::uint32_t>(match - m_formats.begin());
+}
+
+void StylesReader::collect(const ZipArchive &excelArchive,
+                           std::vector<std::byte> &buffer,
+                           ZipReadOptions zipOptions) {
+  if (excelArchive.find("xl/styles.xml") == nullptr) {
+    return;
+  }
+
+  auto parser = createXmlParser();
+  XML_SetUserData(parser.get(), this);
+  XML_SetElementHandler(parser.get(), StylesReader::startElement,
+                        StylesReader::endElement);
+
+  for ([[maybe_unused]] auto parsedBytes :
+       parseZipEntry(parser.get(), excelArchive, "xl/styles.xml", buffer,
+                     zipOptions)) {
+  }
+  // Only needed while compiling
+  m_formatCodes.clear();
+}
@@ -1,39 +1,97 @@
 #include "Utils.h"
 
-#include <format>
-#include <minizip/unzip.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <span>
 #include <string>
 #include <vector>
 
+#include "PipelinedInflater.h"
 #include "generator.h"
 
-generator<std::span<std::byte>>
-ZipUtils::readFileChunked(unzFile file, std::string_view zipEntry) {
-  if (unzLocateFile(file, zipEntry.data(), 0) != UNZ_OK) {
-    throw MalformedZipFileException(
-        std::format("Failed to locate file '{}' in ZIP archive", zipEntry));
+// Upper bound for a single view over a contiguous entry, keeps the length
+// within what expat's int-sized XML_Parse can take.
+constexpr std::size_t kMaxMappedChunk = 64 * 1024 * 1024;
+
+constexpr std::size_t kMinChunkSize = 64 * 1024;
+constexpr std::size_t kMaxChunkSize = 1024 * 1024;
+// Aim for roughly this many parse round-trips per entry before the chunk
+// size hits its ceiling
+constexpr std::uint64_t kTargetChunkCount = 256;
+
+std::size_t ZipUtils::chunkSizeFor(std::uint64_t uncompressedSize) {
+  std::size_t chunkSize = kMinChunkSize;
+  while (chunkSize < kMaxChunkSize &&
+         chunkSize * kTargetChunkCount < uncompressedSize) {
+    chunkSize *= 2;
   }
-  
+  return chunkSize;
+}
+
+std::size_t ZipUtils::chunkSizeFor(const ZipEntry &entry,
+                                   ZipReadOptions options) {
+  return options.chunkSize > 0 ? std::min(options.chunkSize, kMaxMappedChunk)
+                               : chunkSizeFor(entry.uncompressedSize);
+}
+
+generator<std::span<const std::byte>>
+ZipUtils::readFileChunked(const ZipArchive &archive,
+                          std::string_view zipEntry, ZipReadOptions options) {
+  std::vector<std::byte> buffer;
+  for (auto chunk : readFileChunked(archive, zipEntry, buffer, options)) {
+    co_yield chunk;
+  }
+}
 
-  if (unzOpenCurrentFile(file) != UNZ_OK) {
-    throw MalformedZipFileException(
-        std::format("Failed to open file '{}' in ZIP archive", zipEntry));
+generator<std::span<const std::byte>>
+ZipUtils::readFileChunked(const ZipArchive &archive,
+                          std::string_view zipEntry,
+                          std::vector<std::byte> &buffer,
+                          ZipReadOptions options) {
+  ZipEntryReader reader(archive, zipEntry, options.inflateBackend);
+  for (auto chunk : readFileChunked(reader, buffer, options)) {
+    co_yield chunk;
+  }
+}
+
+generator<std::span<const std::byte>>
+ZipUtils::readFileChunked(ZipEntryReader &reader,
+                          std::vector<std::byte> &buffer,
+                          ZipReadOptions options) {
+  if (reader.isContiguous()) {
+    std::span<const std::byte> view;
+    while (!(view = reader.readMapped(kMaxMappedChunk)).empty()) {
+      co_yield view;
+    }
+    co_return;
   }
 
-  std::vector<std::byte> buffer(8192);
-  int bytesRead;
+  std::size_t chunkSize = chunkSizeFor(reader.entry(), options);
 
-  while ((bytesRead = unzReadCurrentFile(file, buffer.data(), buffer.size())) >
-         0) {
-    co_yield std::span<std::byte>(buffer.data(), bytesRead);
+  if (options.pipelined) {
+#ifdef EXCEL2CSV_THREADS
+    // The ring owns its buffers, the caller's one stays untouched
+    PipelinedInflater inflater(reader, chunkSize);
+    std::span<const std::byte> chunk;
+    while (!(chunk = inflater.next()).empty()) {
+      co_yield chunk;
+    }
+    co_return;
+#else
+    throw std::invalid_argument("excel2csv was built without thread support");
+#endif
   }
 
-  if (bytesRead < 0) {
-    throw MalformedZipFileException("Failed to read file from ZIP archive");
+  if (buffer.size() < chunkSize) {
+    buffer.resize(chunkSize);
   }
+  std::span<std::byte> window(buffer.data(), chunkSize);
+  std::size_t bytesRead;
 
-  unzCloseCurrentFile(file);
+  while ((bytesRead = reader.read(window)) > 0) {
+    co_yield std::span<const std::byte>(buffer.data(), bytesRead);
+  }
 }
 
 int stringToNumber(const std::string &str) {
@@ -0,0 +1,355 @@
+#include "XmlParser.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "NumberCodec.h"
+#include "Utils.h"
+#include "XmlTag.h"
+
+void ExcelRowBuilder::project(ColumnSelection columns) {
+  this->selection = std::move(columns);
+  this->rows.resetOpenRow(this->selection->size());
+}
+
+void ExcelRowBuilder::projectByHeader(std::vector<std::string> names) {
+  this->header_names = std::move(names);
+}
+
+void ExcelRowBuilder::limitRows(std::size_t skipRows,
+                                std::optional<std::size_t> maxRows) {
+  this->skip_rows = skipRows;
+  this->max_rows = maxRows.value_or(SIZE_MAX);
+}
+
+bool ExcelRowBuilder::beginCell(std::optional<std::uint32_t> column,
+                                std::uint32_t style) {
+  std::uint32_t current = column.value_or(this->next_column);
+  this->next_column = current + 1;
+  if (this->styles != nullptr) {
+    this->cell_format = this->styles->formatOf(style);
+  }
+
+  if (!this->isRowWanted() && this->header_names.empty()) {
+    // A skipped header row is still built, the columns come from it
+    this->cell_wanted = false;
+  } else if (this->selection.has_value()) {
+    auto slot = this->selection->slotOf(current);
+    this->cell_wanted = slot.has_value();
+    this->cell_slot = slot.value_or(0);
+  } else if (!this->header_names.empty()) {
+    this->header_columns.push_back(current);
+  }
+  return this->cell_wanted;
+}
+
+void ExcelRowBuilder::push(ExcelCell cell) {
+  assert(!this->isBuilt());
+  if (!this->cell_wanted) {
+    return;
+  }
+  if (this->cell_format != 0 && cell.kind() == ExcelCell::Kind::NumberText) {
+    // Formatting beats the source text
+    if (auto number = parseNumber(cell.asNumberText())) {
+      cell = ExcelCell::number(number.value());
+    }
+  }
+  if (this->cell_format != 0 && cell.kind() == ExcelCell::Kind::Number) {
+    cell = ExcelCell::number(cell.asNumber(), this->cell_format);
+  }
+  if (!this->selection.has_value()) {
+    this->rows.push(cell);
+  } else {
+    this->rows.set(this->cell_slot, cell);
+  }
+}
+
+std::optional<std::string_view>
+ExcelRowBuilder::headerText(const ExcelCell &cell) const {
+  if (cell.kind() == ExcelCell::Kind::String) {
+    return cell.asString();
+  }
+  if (cell.kind() == ExcelCell::Kind::SharedString &&
+      this->shared_strings != nullptr) {
+    return this->shared_strings->viewStringEntry(cell.sharedStringIndex());
+  }
+  return std::nullopt;
+}
+
+void ExcelRowBuilder::resolveHeader() {
+  auto header = this->rows.openRow();
+  std::vector<std::uint32_t> columns;
+  std::vector<ExcelCell> projected;
+  std::vector<std::size_t> cells;
+  for (const auto &name : this->header_names) {
+    auto match = std::find_if(header.begin(), header.end(), [&](auto &cell) {
+      return headerText(cell) == name;
+    });
+    if (match == header.end() || this->header_columns.size() != header.size()) {
+      this->missing_headers.push_back(name);
+      continue;
+    }
+    std::size_t cell = match - header.begin();
+    if (std::find(cells.begin(), cells.end(), cell) != cells.end()) {
+      // Names repeating in the request map to the same cell only once
+      continue;
+    }
+    cells.push_back(cell);
+    columns.push_back(this->header_columns[cell]);
+    // Still points into the batch, the bytes stay where they are
+    projected.push_back(*match);
+  }
+  this->header_names.clear();
+  this->header_columns.clear();
+
+  this->project(ColumnSelection::fromColumns(std::move(columns)).value());
+  std::copy(projected.begin(), projected.end(), this->rows.openRow().begin());
+}
+
+void ExcelRowBuilder::reset() {
+  if (!this->header_names.empty()) {
+    resolveHeader();
+  }
+  if (this->isRowWanted()) {
+    this->rows.completeRow();
+    this->rows_kept++;
+  }
+  this->rows.resetOpenRow(this->selection.has_value() ? this->selection->size()
+                                                      : 0);
+  this->rows_seen++;
+  this->next_column = 0;
+  this->cell_wanted = true;
+  this->is_done = false;
+}
+
+void XmlParser::onElementStart(const char *name, const char **atts) {
+  using Phase = XmlParserState::Phase;
+  XmlTag tag = classifyTag(name);
+
+  switch (m_state.phase) {
+  case Phase::WaitingForSheetData:
+    if (tag == XmlTag::SheetData) {
+      m_state.phase = Phase::WaitingForRow;
+    }
+    break;
+  case Phase::WaitingForRow:
+    if (tag == XmlTag::Row) {
+      m_state.phase = Phase::WaitingForCell;
+    }
+    break;
+  case Phase::WaitingForCell:
+    if (tag == XmlTag::C) {
+      bool needsColumn = m_currentRowBuilder.needsColumns();
+      bool needsStyle = m_currentRowBuilder.needsStyles();
+      std::optional<std::uint32_t> column;
+      std::uint32_t style = 0;
+      m_state.cellType = CellType::Number;
+      for (int i = 0; atts[i]; i += 2) {
+        if (strcmp(atts[i], "t") == 0) {
+          m_state.cellType = parseCellType(atts[i + 1]);
+        } else if (needsColumn && strcmp(atts[i], "r") == 0) {
+          column = parseColumnReference(atts[i + 1]);
+        } else if (needsStyle && strcmp(atts[i], "s") == 0) {
+          style = static_cast<std::uint32_t>(stringToNumber(atts[i + 1]));
+        }
+      }
+      m_state.cellSelected = m_currentRowBuilder.beginCell(column, style);
+      m_state.phase = Phase::WaitingForValue;
+    }
+    break;
+  case Phase::WaitingForValue:
+    if (tag == XmlTag::V) {
+      m_state.cellValue.clear();
+      m_state.phase = Phase::InValue;
+    } else if (tag == XmlTag::Is) {
+      m_state.cellValue.clear();
+      m_state.phase = Phase::InInlineString;
+    }
+    break;
+  case Phase::InInlineString:
+    if (tag == XmlTag::T) {
+      m_state.phase = Phase::InInlineText;
+    }
+    break;
+  case Phase::InValue:
+  case Phase::InInlineText:
+  case Phase::Done:
+    break;
+  }
+}
+
+void XmlParser::onElementEnd(const char *name) {
+  using Phase = XmlParserState::Phase;
+  XmlTag tag = classifyTag(name);
+
+  switch (m_state.phase) {
+  case Phase::InValue:
+    if (tag == XmlTag::V) {
+      if (m_state.cellSelected) {
+        m_currentRowBuilder.push(
+            createExcelCell(stringTableReader, m_state.cellType,
+                            m_state.cellValue,
+                            m_currentRowBuilder.keepsNumberText()));
+      }
+      m_state.phase = Phase::WaitingForCell;
+    }
+    break;
+  case Phase::WaitingForValue:
+    if (tag == XmlTag::C) {
+      // Cell without a value, e.g. a styled blank <c r="B2" s="1"/>
+      m_currentRowBuilder.push(ExcelCell());
+      m_state.phase = Phase::WaitingForCell;
+    }
+    break;
+  case Phase::InInlineText:
+    if (tag == XmlTag::T) {
+      m_state.phase = Phase::InInlineString;
+    }
+    break;
+  case Phase::InInlineString:
+    if (tag == XmlTag::Is) {
+      if (m_state.cellSelected) {
+        m_currentRowBuilder.push(ExcelCell::string(m_state.cellValue));
+      }
+      m_state.phase = Phase::WaitingForCell;
+    }
+    break;
+  case Phase::WaitingForCell:
+    if (tag == XmlTag::Row) {
+      m_state.phase = Phase::WaitingForRow;
+      completeRow();
+    }
+    break;
+  case Phase::WaitingForRow:
+    if (tag == XmlTag::SheetData) {
+      // The rest of the worksheet is formatting, no need to inflate it
+      stop();
+    }
+    break;
+  case Phase::WaitingForSheetData:
+  case Phase::Done:
+    break;
+  }
+}
+
+void XmlParser::onCharacterData(const char *s, int len) {
+  if (!m_state.cellSelected) {
+    return;
+  }
+  if (m_state.phase == XmlParserState::Phase::InValue ||
+      m_state.phase == XmlParserState::Phase::InInlineText) {
+    m_state.cellValue.append(s, len);
+  }
+}
+
+void XmlParser::completeRow() {
+  m_currentRowBuilder.seal();
+  m_currentRowBuilder.reset();
+  if (m_currentRowBuilder.isExhausted()) {
+    stop();
+  }
+}
+
+void XmlParser::stop() {
+  m_state.phase = XmlParserState::Phase::Done;
+  if (m_parser != nullptr) {
+    XML_StopParser(m_parser, XML_FALSE);
+  }
+}
+
+static void XMLCALL startElement(void *userData, const char *name,
+                                 const char **atts) {
+  auto xmlParser = static_cast<XmlParser *>(userData);
+  xmlParser->onElementStart(name, atts);
+}
+
+static void XMLCALL endElement(void *userData, const char *name) {
+  auto xmlParser = static_cast<XmlParser *>(userData);
+  xmlParser->onElementEnd(name);
+}
+
+static void XMLCALL charDataHandler(void *userData, const char *s, int len) {
+  auto xmlParser = static_cast<XmlParser *>(userData);
+  xmlParser->onCharacterData(s, len);
+}
+
+void XmlParser::attach(XML_Parser parser) {
+  m_parser = parser;
+  XML_SetUserData(parser, this);
+  XML_SetElementHandler(parser, startElement, endElement);
+  XML_SetCharacterDataHandler(parser, charDataHandler);
+  XML_SetParamEntityParsing(parser, XML_PARAM_ENTITY_PARSING_NEVER);
+}
+
+ExcelCell createExcelCell(const StringTableReader &stringTableReader,
+                          CellType cellType, const std::string &cellValue,
+                          bool numberText) {
+  if (cellType == CellType::SharedString) {
+    // Resolved when the row is written, the table outlives the rows. Waits
+    // for the string while the table is collected in the background
+    int index = stringToNumber(cellValue);
+    if (index >= 0 &&
+        stringTableReader.hasStringEntry(static_cast<std::size_t>(index))) {
+      return ExcelCell::sharedString(static_cast<std::uint32_t>(index));
+    }
+    return ExcelCell::string(cellValue);
+  }
+  if (cellType == CellType::Boolean) {
+    return ExcelCell::boolean(cellValue == "1");
+  }
+  // Everything else is tried as a number first
+  if (numberText && isNumberText(cellValue)) {
+    return ExcelCell::numberText(cellValue);
+  }
+  if (auto number = parseNumber(cellValue)) {
+    return ExcelCell::number(number.value());
+  }
+  return ExcelCell::string(cellValue); // Fallback to string
+}
+
+XmlParserHandle createXmlParser() {
+  XmlParserHandle parser(XML_ParserCreate(nullptr));
+  if (!parser) {
+    throw std::runtime_error("Failed to allocate parser");
+  }
+  return parser;
+}
+
+// A handler called XML_StopParser, the document isn't malformed
+static bool wasStopped(XML_Parser parser) {
+  return XML_GetErrorCode(parser) == XML_ERROR_ABORTED;
+}
+
+generator<std::size_t> parseZipEntry(XML_Parser parser,
+                                     const ZipArchive &archive,
+                                     std::string_view zipEntry,
+                                     std::vector<std::byte> &buffer,
+                                     ZipReadOptions options) {
+  ZipEntryReader reader(archive, zipEntry, options.inflateBackend);
+
+  // XML_Parse also for deflated entries: inflating straight into expat's
+  // buffer with XML_GetBuffer/XML_ParseBuffer measured slower in
+  // BENCHMARK-expatFeed
+  for (auto &chunk : ZipUtils::readFileChunked(reader, buffer, options)) {
+    auto start = reinterpret_cast<const char *>(chunk.data());
+    int length = static_cast<int>(chunk.size());
+    if (XML_Parse(parser, start, length, XML_FALSE) == XML_STATUS_ERROR) {
+      if (wasStopped(parser)) {
+        co_return;
+      }
+      throw MalformedExcelFileException(
+          std::string("Error while reading ").append(zipEntry));
+    }
+    co_yield chunk.size();
+  }
+  if (XML_Parse(parser, nullptr, 0, XML_TRUE) == XML_STATUS_ERROR &&
+      !wasStopped(parser)) {
+    throw MalformedExcelFileException(
+        std::string("Error finalizing XML parse of ").append(zipEntry));
+  }
+}
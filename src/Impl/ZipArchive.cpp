@@ -0,0 +1,376 @@
+#include "ZipArchive.h"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <string>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+#include "Utils.h"
+
+#ifdef EXCEL2CSV_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
+namespace {
+
+constexpr std::uint32_t kLocalHeaderSignature = 0x04034b50;
+constexpr std::uint32_t kCentralHeaderSignature = 0x02014b50;
+constexpr std::uint32_t kEndOfCentralDirSignature = 0x06054b50;
+constexpr std::uint32_t kZip64EndOfCentralDirSignature = 0x06064b50;
+constexpr std::uint32_t kZip64LocatorSignature = 0x07064b50;
+constexpr std::uint16_t kZip64ExtraFieldId = 0x0001;
+
+constexpr std::size_t kLocalHeaderSize = 30;
+constexpr std::size_t kCentralHeaderSize = 46;
+constexpr std::size_t kEndOfCentralDirSize = 22;
+constexpr std::size_t kZip64LocatorSize = 20;
+constexpr std::size_t kZip64EndOfCentralDirSize = 56;
+constexpr std::size_t kMaxCommentSize = 0xFFFF;
+
+constexpr std::uint16_t kMethodStored = 0;
+constexpr std::uint16_t kMethodDeflated = 8;
+constexpr std::uint16_t kFlagEncrypted = 0x0001;
+
+// Entries above this size are streamed through zlib even when libdeflate was
+// requested, so a single huge sheet can't take the whole process down.
+constexpr std::uint64_t kMaxWholeBufferInflate = 256 * 1024 * 1024;
+
+std::uint16_t readU16(const std::byte *p) {
+  return static_cast<std::uint16_t>(std::to_integer<unsigned>(p[0]) |
+                                    std::to_integer<unsigned>(p[1]) << 8);
+}
+
+std::uint32_t readU32(const std::byte *p) {
+  return static_cast<std::uint32_t>(readU16(p)) |
+         static_cast<std::uint32_t>(readU16(p + 2)) << 16;
+}
+
+std::uint64_t readU64(const std::byte *p) {
+  return static_cast<std::uint64_t>(readU32(p)) |
+         static_cast<std::uint64_t>(readU32(p + 4)) << 32;
+}
+
+} // namespace
+
+std::optional<InflateBackend> parseInflateBackend(std::string_view name) {
+  if (name == "zlib") {
+    return InflateBackend::Zlib;
+  }
+  if (name == "libdeflate") {
+    return InflateBackend::Libdeflate;
+  }
+  return std::nullopt;
+}
+
+bool isInflateBackendAvailable(InflateBackend backend) {
+  switch (backend) {
+  case InflateBackend::Zlib:
+    return true;
+  case InflateBackend::Libdeflate:
+#ifdef EXCEL2CSV_LIBDEFLATE
+    return true;
+#else
+    return false;
+#endif
+  }
+  return false;
+}
+
+std::optional<ZipArchive> ZipArchive::open(std::string_view filePath) {
+  int fd = ::open(std::string(filePath).c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return std::nullopt;
+  }
+
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+    ::close(fd);
+    return std::nullopt;
+  }
+
+  auto size = static_cast<std::size_t>(fileStat.st_size);
+  void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps its own reference to the file
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    return std::nullopt;
+  }
+  madvise(mapping, size, MADV_SEQUENTIAL);
+
+  ZipArchive archive(static_cast<const std::byte *>(mapping), size);
+  try {
+    archive.indexCentralDirectory();
+  } catch (const MalformedZipFileException &) {
+    return std::nullopt;
+  }
+  return archive;
+}
+
+ZipArchive::ZipArchive(const std::byte *data, std::size_t size)
+    : m_data(data), m_size(size) {}
+
+ZipArchive::ZipArchive(ZipArchive &&other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr)),
+      m_size(std::exchange(other.m_size, 0)),
+      m_entries(std::move(other.m_entries)) {}
+
+ZipArchive &ZipArchive::operator=(ZipArchive &&other) noexcept {
+  if (this != &other) {
+    release();
+    m_data = std::exchange(other.m_data, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+    m_entries = std::move(other.m_entries);
+  }
+  return *this;
+}
+
+ZipArchive::~ZipArchive() { release(); }
+
+void ZipArchive::release() {
+  if (m_data != nullptr) {
+    munmap(const_cast<std::byte *>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+  }
+}
+
+void ZipArchive::indexCentralDirectory() {
+  if (m_size < kEndOfCentralDirSize) {
+    throw MalformedZipFileException("File is too small to be a ZIP archive");
+  }
+
+  // The end of central directory record sits at the very end of the file,
+  // followed only by an optional comment of up to 64 KiB.
+  std::size_t searchFloor =
+      m_size > kEndOfCentralDirSize + kMaxCommentSize
+          ? m_size - kEndOfCentralDirSize - kMaxCommentSize
+          : 0;
+  std::size_t eocd = m_size - kEndOfCentralDirSize;
+  while (readU32(m_data + eocd) != kEndOfCentralDirSignature) {
+    if (eocd == searchFloor) {
+      throw MalformedZipFileException(
+          "Missing end of central directory record");
+    }
+    --eocd;
+  }
+
+  std::uint64_t entryCount = readU16(m_data + eocd + 10);
+  std::uint64_t directorySize = readU32(m_data + eocd + 12);
+  std::uint64_t directoryOffset = readU32(m_data + eocd + 16);
+
+  if (entryCount == 0xFFFF || directorySize == 0xFFFFFFFF ||
+      directoryOffset == 0xFFFFFFFF) {
+    if (eocd < kZip64LocatorSize ||
+        readU32(m_data + eocd - kZip64LocatorSize) != kZip64LocatorSignature) {
+      throw MalformedZipFileException("Missing ZIP64 end of central directory");
+    }
+    std::uint64_t zip64Eocd = readU64(m_data + eocd - kZip64LocatorSize + 8);
+    if (m_size < kZip64EndOfCentralDirSize ||
+        zip64Eocd > m_size - kZip64EndOfCentralDirSize ||
+        readU32(m_data + zip64Eocd) != kZip64EndOfCentralDirSignature) {
+      throw MalformedZipFileException("Corrupt ZIP64 end of central directory");
+    }
+    entryCount = readU64(m_data + zip64Eocd + 32);
+    directorySize = readU64(m_data + zip64Eocd + 40);
+    directoryOffset = readU64(m_data + zip64Eocd + 48);
+  }
+
+  if (directoryOffset > m_size || directorySize > m_size - directoryOffset) {
+    throw MalformedZipFileException("Central directory lies outside the file");
+  }
+
+  m_entries.reserve(std::min<std::uint64_t>(
+      entryCount, directorySize / kCentralHeaderSize));
+  const std::byte *cursor = m_data + directoryOffset;
+  const std::byte *directoryEnd = cursor + directorySize;
+
+  for (std::uint64_t i = 0; i < entryCount; ++i) {
+    if (static_cast<std::size_t>(directoryEnd - cursor) < kCentralHeaderSize ||
+        readU32(cursor) != kCentralHeaderSignature) {
+      throw MalformedZipFileException("Corrupt central directory entry");
+    }
+
+    ZipEntry entry;
+    entry.flags = readU16(cursor + 8);
+    entry.compressionMethod = readU16(cursor + 10);
+    entry.compressedSize = readU32(cursor + 20);
+    entry.uncompressedSize = readU32(cursor + 24);
+    std::uint16_t nameLength = readU16(cursor + 28);
+    std::uint16_t extraLength = readU16(cursor + 30);
+    std::uint16_t commentLength = readU16(cursor + 32);
+    entry.localHeaderOffset = readU32(cursor + 42);
+
+    const std::byte *name = cursor + kCentralHeaderSize;
+    const std::byte *extra = name + nameLength;
+    const std::byte *next = extra + extraLength + commentLength;
+    if (next > directoryEnd) {
+      throw MalformedZipFileException("Corrupt central directory entry");
+    }
+
+    // ZIP64 extra field carries only the values saturated in the header,
+    // in a fixed order.
+    for (const std::byte *field = extra; field + 4 <= extra + extraLength;) {
+      std::uint16_t fieldId = readU16(field);
+      std::uint16_t fieldSize = readU16(field + 2);
+      const std::byte *value = field + 4;
+      const std::byte *valueEnd = value + fieldSize;
+      if (valueEnd > extra + extraLength) {
+        break;
+      }
+      if (fieldId == kZip64ExtraFieldId) {
+        for (std::uint64_t *target :
+             {&entry.uncompressedSize, &entry.compressedSize,
+              &entry.localHeaderOffset}) {
+          if (*target == 0xFFFFFFFF && value + 8 <= valueEnd) {
+            *target = readU64(value);
+            value += 8;
+          }
+        }
+      }
+      field = valueEnd;
+    }
+
+    m_entries.emplace(
+        std::string(reinterpret_cast<const char *>(name), nameLength), entry);
+    cursor = next;
+  }
+}
+
+const ZipEntry *ZipArchive::find(std::string_view entryName) const {
+  auto it = m_entries.find(entryName);
+  return it == m_entries.end() ? nullptr : &it->second;
+}
+
+std::span<const std::byte> ZipArchive::entryData(const ZipEntry &entry) const {
+  if (m_size < kLocalHeaderSize ||
+      entry.localHeaderOffset > m_size - kLocalHeaderSize ||
+      readU32(m_data + entry.localHeaderOffset) != kLocalHeaderSignature) {
+    throw MalformedZipFileException("Corrupt local file header");
+  }
+  const std::byte *header = m_data + entry.localHeaderOffset;
+  std::uint64_t dataOffset = entry.localHeaderOffset + kLocalHeaderSize +
+                             readU16(header + 26) + readU16(header + 28);
+  if (dataOffset > m_size || entry.compressedSize > m_size - dataOffset) {
+    throw MalformedZipFileException("Entry data lies outside the file");
+  }
+  return {m_data + dataOffset, static_cast<std::size_t>(entry.compressedSize)};
+}
+
+ZipEntryReader::ZipEntryReader(const ZipArchive &archive,
+                               std::string_view entryName,
+                               InflateBackend backend) {
+  if (!isInflateBackendAvailable(backend)) {
+    throw std::invalid_argument(
+        "excel2csv was built without libdeflate support");
+  }
+
+  const ZipEntry *entry = archive.find(entryName);
+  if (entry == nullptr) {
+    throw MalformedZipFileException(
+        std::format("Failed to locate file '{}' in ZIP archive", entryName));
+  }
+  if ((entry->flags & kFlagEncrypted) != 0 ||
+      (entry->compressionMethod != kMethodStored &&
+       entry->compressionMethod != kMethodDeflated)) {
+    throw MalformedZipFileException(
+        std::format("Failed to open file '{}' in ZIP archive", entryName));
+  }
+
+  m_entry = *entry;
+  m_data = archive.entryData(m_entry);
+
+  if (m_entry.compressionMethod != kMethodDeflated) {
+    return;
+  }
+
+#ifdef EXCEL2CSV_LIBDEFLATE
+  if (backend == InflateBackend::Libdeflate &&
+      m_entry.uncompressedSize <= kMaxWholeBufferInflate) {
+    auto *decompressor = libdeflate_alloc_decompressor();
+    if (decompressor == nullptr) {
+      throw std::runtime_error("Failed to allocate libdeflate decompressor");
+    }
+    m_decoded.resize(m_entry.uncompressedSize);
+    std::size_t decodedSize = 0;
+    auto result = libdeflate_deflate_decompress(
+        decompressor, m_data.data(), m_data.size(), m_decoded.data(),
+        m_decoded.size(), &decodedSize);
+    libdeflate_free_decompressor(decompressor);
+    if (result != LIBDEFLATE_SUCCESS) {
+      throw MalformedZipFileException("Failed to read file from ZIP archive");
+    }
+    m_data = std::span<const std::byte>(m_decoded.data(), decodedSize);
+    return;
+  }
+#endif
+
+  // Negative window bits: raw deflate stream without a zlib header
+  if (inflateInit2(&m_stream, -MAX_WBITS) != Z_OK) {
+    throw MalformedZipFileException(
+        std::format("Failed to open file '{}' in ZIP archive", entryName));
+  }
+  m_inflating = true;
+}
+
+ZipEntryReader::~ZipEntryReader() {
+  if (m_inflating) {
+    inflateEnd(&m_stream);
+  }
+}
+
+std::span<const std::byte> ZipEntryReader::readMapped(std::size_t maxBytes) {
+  assert(isContiguous());
+  auto view = m_data.subspan(m_consumed,
+                             std::min(maxBytes, m_data.size() - m_consumed));
+  m_consumed += view.size();
+  m_finished = m_consumed == m_data.size();
+  return view;
+}
+
+std::size_t ZipEntryReader::read(std::span<std::byte> out) {
+  if (m_finished || out.empty()) {
+    return 0;
+  }
+
+  if (!m_inflating) {
+    auto view = readMapped(out.size());
+    std::memcpy(out.data(), view.data(), view.size());
+    return view.size();
+  }
+
+  m_stream.next_out = reinterpret_cast<Bytef *>(out.data());
+  std::size_t limit = std::min<std::size_t>(out.size(), UINT_MAX);
+  m_stream.avail_out = static_cast<uInt>(limit);
+
+  while (m_stream.avail_out > 0) {
+    if (m_stream.avail_in == 0 && m_consumed < m_data.size()) {
+      // The whole compressed payload is already mapped, so input is only
+      // re-pointed when it exceeds what a single z_stream call can address.
+      std::size_t count =
+          std::min<std::size_t>(m_data.size() - m_consumed, UINT_MAX);
+      m_stream.next_in = reinterpret_cast<Bytef *>(
+          const_cast<std::byte *>(m_data.data() + m_consumed));
+      m_stream.avail_in = static_cast<uInt>(count);
+      m_consumed += count;
+    }
+
+    int status = inflate(&m_stream, Z_NO_FLUSH);
+    if (status == Z_STREAM_END) {
+      m_finished = true;
+      break;
+    }
+    if (status != Z_OK) {
+      throw MalformedZipFileException("Failed to read file from ZIP archive");
+    }
+  }
+
+  return limit - m_stream.avail_out;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Bump allocator handing out memory from a list of blocks. Nothing is freed
+// one by one: reset() rewinds to the first block and keeps the blocks for
+// the next round, so once warmed up allocating costs no malloc at all.
+class Arena {
+private:
+  struct Block {
+    std::unique_ptr<std::byte[]> data;
+    std::size_t size;
+    // Taken over from another arena, see adopt()
+    bool adopted;
+  };
+
+  std::size_t m_blockSize;
+  std::vector<Block> m_blocks;
+  // Block being filled, and how much of it is
+  std::size_t m_current = 0;
+  std::size_t m_used = 0;
+
+public:
+  static constexpr std::size_t kDefaultBlockSize = 64 * 1024;
+
+  explicit Arena(std::size_t blockSize = kDefaultBlockSize)
+      : m_blockSize(blockSize) {}
+  Arena(Arena &&) = default;
+  Arena &operator=(Arena &&) = default;
+
+  // `size` bytes aligned to `alignment`, valid until reset(). Requests larger
+  // than the block size get a block of their own.
+  void *allocate(std::size_t size,
+                 std::size_t alignment = alignof(std::max_align_t));
+
+  // Copies `text` into the arena
+  std::string_view store(std::string_view text);
+
+  // Makes everything allocated so far invalid. Regular blocks are kept,
+  // oversized and adopted ones freed, so the arena's size stays that of its
+  // busiest round.
+  void reset();
+
+  // Takes over `other`'s blocks, what was allocated from them stays valid
+  // until this arena's reset().
+  void adopt(Arena &&other);
+
+  // Bytes held in blocks
+  std::size_t capacity() const;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// Zero-based column of a cell reference such as "B12" or a bare column name
+// such as "AA". Returns nullopt without leading letters or past XFD.
+std::optional<std::uint32_t> parseColumnReference(std::string_view reference);
+
+// The columns to output, in output order. Each selected column gets one slot
+// in every row, cells of other columns are dropped by the parsers.
+class ColumnSelection {
+private:
+  std::vector<std::uint32_t> m_columns;
+  // Slot of every column up to the highest selected one, kNotSelected for the
+  // gaps, so looking up a cell is a single index
+  std::vector<std::uint32_t> m_slots;
+
+  static constexpr std::uint32_t kNotSelected = UINT32_MAX;
+
+public:
+  // Excel's last column is XFD
+  static constexpr std::uint32_t kMaxColumns = 16384;
+
+  // Returns nullopt if a column repeats or is out of range.
+  static std::optional<ColumnSelection>
+  fromColumns(std::vector<std::uint32_t> columns);
+
+  // Parses a list such as "A,C,F:H". Returns nullopt if it is malformed.
+  static std::optional<ColumnSelection> parse(std::string_view spec);
+
+  std::size_t size() const { return m_columns.size(); }
+  const std::vector<std::uint32_t> &columns() const { return m_columns; }
+
+  std::optional<std::size_t> slotOf(std::uint32_t column) const {
+    if (column >= m_slots.size() || m_slots[column] == kNotSelected) {
+      return std::nullopt;
+    }
+    return m_slots[column];
+  }
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// How a field has to be written to CSV
+enum class CsvQuoting : std::uint8_t {
+  // As it is
+  None,
+  // Between quotes, it holds a comma or a line break
+  Quoted,
+  // Between quotes, with its own quotes doubled
+  Escaped,
+};
+
+// One pass over `field`
+CsvQuoting csvQuotingOf(std::string_view field);
+
+// Appends `field` the way `quoting` says, which has to be csvQuotingOf(field)
+void appendCsvField(std::string &result, std::string_view field,
+                    CsvQuoting quoting);
+inline void appendCsvField(std::string &result, std::string_view field) {
+  appendCsvField(result, field, csvQuotingOf(field));
+}
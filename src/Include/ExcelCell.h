@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "ExcelValue.h"
+#include "NumberCodec.h"
+
+// One cell in 16 bytes: a tag and a double, a bool, a shared string index or
+// a string. String cells don't own their bytes, they point into the RowBatch
+// holding the row (or whatever the creator keeps alive). The default cell is
+// the empty string.
+//
+// NumberText cells are numbers kept as the sheet's text, written out as is
+// and only converted when a double is asked for. Number cells may carry a
+// number format, an index into the workbook's StylesReader.
+class ExcelCell {
+public:
+  enum class Kind : std::uint8_t {
+    String,
+    Number,
+    Boolean,
+    SharedString,
+    NumberText
+  };
+
+private:
+  union {
+    const char *m_data;
+    double m_number;
+    bool m_boolean;
+    std::uint32_t m_index;
+  };
+  std::uint32_t m_size = 0;
+  Kind m_kind = Kind::String;
+
+public:
+  constexpr ExcelCell() : m_data("") {}
+
+  static ExcelCell string(std::string_view text) {
+    ExcelCell cell;
+    if (!text.empty()) {
+      cell.m_data = text.data();
+      cell.m_size = static_cast<std::uint32_t>(text.size());
+    }
+    return cell;
+  }
+  static ExcelCell number(double number, std::uint32_t format = 0) {
+    ExcelCell cell;
+    cell.m_number = number;
+    cell.m_size = format;
+    cell.m_kind = Kind::Number;
+    return cell;
+  }
+  static ExcelCell numberText(std::string_view text) {
+    ExcelCell cell = string(text);
+    cell.m_kind = Kind::NumberText;
+    return cell;
+  }
+  static ExcelCell boolean(bool boolean) {
+    ExcelCell cell;
+    cell.m_boolean = boolean;
+    cell.m_kind = Kind::Boolean;
+    return cell;
+  }
+  static ExcelCell sharedString(std::uint32_t index) {
+    ExcelCell cell;
+    cell.m_index = index;
+    cell.m_kind = Kind::SharedString;
+    return cell;
+  }
+
+  Kind kind() const { return m_kind; }
+
+  std::string_view asString() const {
+    assert(m_kind == Kind::String);
+    return {m_data, m_size};
+  }
+  double asNumber() const {
+    assert(m_kind == Kind::Number);
+    return m_number;
+  }
+  // 0 for General
+  std::uint32_t numberFormat() const {
+    assert(m_kind == Kind::Number);
+    return m_size;
+  }
+  std::string_view asNumberText() const {
+    assert(m_kind == Kind::NumberText);
+    return {m_data, m_size};
+  }
+  bool asBoolean() const {
+    assert(m_kind == Kind::Boolean);
+    return m_boolean;
+  }
+  std::uint32_t sharedStringIndex() const {
+    assert(m_kind == Kind::SharedString);
+    return m_index;
+  }
+};
+
+static_assert(sizeof(ExcelCell) == 16);
+
+// Compatibility adapter for the variant based API. Shared string cells carry
+// no text of their own and have to be resolved by the caller first.
+inline ExcelValue toExcelValue(const ExcelCell &cell) {
+  switch (cell.kind()) {
+  case ExcelCell::Kind::Number:
+    return cell.asNumber();
+  case ExcelCell::Kind::NumberText:
+    if (auto number = parseNumber(cell.asNumberText())) {
+      return number.value();
+    }
+    // Out of range, what the eager conversion would have kept
+    return std::string(cell.asNumberText());
+  case ExcelCell::Kind::Boolean:
+    return cell.asBoolean();
+  case ExcelCell::Kind::String:
+    return std::string(cell.asString());
+  case ExcelCell::Kind::SharedString:
+    break;
+  }
+  assert(false && "unresolved shared string cell");
+  return std::string();
+}
+
+// The other way round, string cells point into `value`
+inline ExcelCell toExcelCell(const ExcelValue &value) {
+  if (auto number = std::get_if<double>(&value)) {
+    return ExcelCell::number(*number);
+  }
+  if (auto boolean = std::get_if<bool>(&value)) {
+    return ExcelCell::boolean(*boolean);
+  }
+  return ExcelCell::string(std::get<std::string>(value));
+}
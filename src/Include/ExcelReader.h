@@ -1,10 +1,118 @@
 #pragma once
 
+#include "ColumnSelection.h"
+#include "ExcelCell.h"
 #include "ExcelValue.h"
+#include "RecordBatch.h"
+#include "RowBatch.h"
+#include "StringTableReader.h"
+#include "StylesReader.h"
+#include "ZipArchive.h"
 #include "generator.h"
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
 #include <vector>
 
+enum class SheetParserKind {
+  // SheetScanner, falling back to expat for markup it doesn't handle
+  Fast,
+  Expat,
+};
+
+std::optional<SheetParserKind> parseSheetParserKind(std::string_view name);
+
+struct ExcelReaderOptions {
+  SheetParserKind parser = SheetParserKind::Fast;
+  InflateBackend inflateBackend = InflateBackend::Zlib;
+  // Inflate on a background thread while parsing, see ZipReadOptions
+  bool pipelined = false;
+  // 0 picks a chunk size per entry, see ZipUtils::chunkSizeFor
+  std::size_t chunkSize = 0;
+  // Output only these columns, one slot each, in this order
+  std::optional<ColumnSelection> columns;
+  // Same, picking the columns by the names in the first row
+  std::vector<std::string> columnHeaders;
+  // Rows of the sheet to drop before the first one read
+  std::size_t skipRows = 0;
+  // Stop parsing, and inflating, after this many rows
+  std::optional<std::size_t> maxRows;
+  // Parse the sheet on this many threads, see ParallelSheetParser. Needs a
+  // build with EXCEL2CSV_THREADS, ignored with columnHeaders
+  std::size_t threads = 1;
+  // Keep numbers as the sheet's text, see ExcelCell::numberText(). read()
+  // still converts them to doubles
+  bool rawNumbers = false;
+  // Give number cells the number format of their style, so dates, times,
+  // percentages and fixed decimals are written the way the sheet shows them.
+  // Reads xl/styles.xml
+  bool numberFormats = false;
+  // Bytes of shared strings kept in memory, the rest goes to a temporary
+  // file, see StringTableReader
+  std::size_t sharedStringsBudget = StringTableReader::kDefaultMemoryBudget;
+  // Decode shared strings when a cell first needs them, caching up to
+  // sharedStringsBudget bytes of them. Saves work when the sheet uses few of
+  // the workbook's strings
+  bool lazySharedStrings = false;
+  // Parse xl/sharedStrings.xml on a background thread while the sheet is
+  // parsed, cells wait for the strings they use. Needs a build with
+  // EXCEL2CSV_THREADS
+  bool concurrentSharedStrings = false;
+};
+
+// A row of ExcelReader::readCells(), along with the tables of the workbook
+// it's read from. The tables belong to that call's generator, so several
+// reads can be under way at once.
+class ExcelRow : public std::span<const ExcelCell> {
+private:
+  const StringTableReader *m_sharedStrings = nullptr;
+  const StylesReader *m_styles = nullptr;
+
+public:
+  ExcelRow() = default;
+  ExcelRow(std::span<const ExcelCell> cells,
+           const StringTableReader &sharedStrings, const StylesReader &styles)
+      : std::span<const ExcelCell>(cells), m_sharedStrings(&sharedStrings),
+        m_styles(&styles) {}
+
+  // What shared string cells index into, valid as long as the generator
+  const StringTableReader &sharedStrings() const { return *m_sharedStrings; }
+  // Number formats of the workbook, see numberFormats
+  const StylesReader &styles() const { return *m_styles; }
+};
+
 class ExcelReader {
+private:
+  ExcelReaderOptions m_options;
+
+  // Rows [first, last) of `rows` are the sheet's next ones. The batch is
+  // refilled once the next chunk is requested, unless its storage is taken
+  struct RowChunk {
+    RowBatch *rows = nullptr;
+    std::size_t first = 0;
+    std::size_t last = 0;
+  };
+
+  // Rows of the first sheet, a chunk of the parser's completed rows at a
+  // time, filling the caller's tables first
+  generator<RowChunk>
+  readRows(std::string_view filePath, StringTableReader &sharedStrings,
+           StylesReader &styles);
+
 public:
+  explicit ExcelReader(ExcelReaderOptions options = {}) : m_options(options) {}
+
+  // Rows of the first sheet as compact cells. A row's cells, and the bytes of
+  // its strings, stay valid until the next row is requested. Shared string
+  // cells are left as indices into the row's sharedStrings().
+  generator<ExcelRow> readCells(std::string_view filePath);
+
+  // Same, converted to ExcelValues
   generator<std::vector<ExcelValue>> read(std::string_view filePath);
+
+  // Same, `batchRows` rows at a time stored column by column. Only the last
+  // batch has fewer rows.
+  generator<RecordBatch> readBatches(std::string_view filePath,
+                                     std::size_t batchRows = 4096);
 };
\ No newline at end of file
@@ -1,4 +1,23 @@
+#pragma once
+
+#include "ExcelCell.h"
 #include "ExcelValue.h"
+#include <span>
+#include <string>
 #include <vector>
 
+class StringTableReader;
+class StylesReader;
+
+// Shared string cells are copied from `sharedStrings`, which rows holding
+// them require. Number cells with a number format are written the way
+// `styles` formats them, as General without it.
+std::string excelRow2Csv(std::span<const ExcelCell> line,
+                         const StringTableReader *sharedStrings = nullptr,
+                         const StylesReader *styles = nullptr);
+// Same, appending to `result` so callers can reuse its buffer
+void excelRow2Csv(std::span<const ExcelCell> line, std::string &result,
+                  const StringTableReader *sharedStrings = nullptr,
+                  const StylesReader *styles = nullptr);
+// Compatibility adapter for the variant based API
 std::string excelRow2Csv(std::vector<ExcelValue> line);
\ No newline at end of file
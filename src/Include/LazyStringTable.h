@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expat.h>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "CsvField.h"
+#include "SpillFile.h"
+#include "Utils.h"
+#include "ZipArchive.h"
+
+// Shared strings left as the raw <si> items of xl/sharedStrings.xml. The
+// inflated entry goes to a SpillFile and a first pass only records where
+// every item starts; an item is decoded by expat when it's first looked up.
+// The most recently used strings are cached up to a budget, so workbooks
+// whose sheet references a few of many strings skip decoding the rest.
+class LazyStringTable {
+private:
+  struct CacheEntry {
+    std::size_t index;
+    std::string text;
+    CsvQuoting quoting;
+  };
+
+  SpillFile m_items;
+  // Item i is at m_offsets[i] up to m_offsets[i + 1], decoding stops at its
+  // </si>
+  std::vector<std::uint64_t> m_offsets;
+
+  std::size_t m_cacheBudget;
+  std::size_t m_cacheUsed = 0;
+  // Most recently used first
+  std::list<CacheEntry> m_recent;
+  std::unordered_map<std::size_t, std::list<CacheEntry>::iterator> m_cached;
+  std::mutex m_mutex;
+
+  // Reused for every item, reset in between
+  XML_Parser m_parser = nullptr;
+  std::string m_text;
+  bool m_inItem = false;
+  bool m_inText = false;
+
+  static void XMLCALL startElement(void *userData, const char *name,
+                                   const char **atts);
+  static void XMLCALL endElement(void *userData, const char *name);
+  static void XMLCALL charDataHandler(void *userData, const char *s, int len);
+
+  bool index(std::string_view xml);
+  std::string decode(std::size_t index);
+  // Caller holds m_mutex
+  const CacheEntry &lookup(std::size_t stringIndex);
+
+public:
+  explicit LazyStringTable(std::size_t cacheBudget)
+      : m_cacheBudget(cacheBudget) {}
+  LazyStringTable(const LazyStringTable &) = delete;
+  LazyStringTable &operator=(const LazyStringTable &) = delete;
+  ~LazyStringTable();
+
+  // Copies xl/sharedStrings.xml to the spill file and indexes its items.
+  // Returns false if the entry has markup its items can't be decoded apart
+  // with, a DTD or an encoding other than UTF-8; it has to be parsed as a
+  // whole then.
+  bool collect(const ZipArchive &excelArchive, std::vector<std::byte> &buffer,
+               ZipReadOptions zipOptions = {});
+
+  std::size_t size() const {
+    return m_offsets.empty() ? 0 : m_offsets.size() - 1;
+  }
+  // String at `stringIndex`, which has to be below size(). Safe to call from
+  // several threads, the view is valid until the next call though. Throws
+  // MalformedExcelFileException if the item isn't well-formed.
+  std::string_view get(std::size_t stringIndex);
+  // How string `stringIndex` is written to CSV, worked out as it's decoded
+  CsvQuoting csvQuoting(std::size_t stringIndex);
+  // Strings decoded and still cached
+  std::size_t cachedCount();
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Conversions between numeric cells' text and doubles. Neither direction
+// allocates, throws or looks at the locale.
+
+// Room formatNumber() needs, sign and exponent included
+inline constexpr std::size_t kMaxNumberLength = 32;
+
+// The number `text` spells out, nullopt unless all of it is a number or if
+// it's out of a double's range.
+std::optional<double> parseNumber(std::string_view text);
+
+// True if `text` is a plain decimal number like the ones in a sheet's <v>,
+// e.g. "-12", "0.5" or "1.2E-3", exactly those parseNumber() takes short of
+// its range. Checked without converting it.
+bool isNumberText(std::string_view text);
+
+// Writes the shortest text that parses back to `number` into `buffer`, which
+// holds kMaxNumberLength chars, and returns its end. Plain decimals from 1e-7
+// to 1e21, scientific notation beyond.
+char *formatNumber(double number, char *buffer);
+
+// Same, appending to `result`
+void appendNumber(std::string &result, double number);
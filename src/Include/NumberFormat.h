@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// A cell number format (numFmt) compiled down to what CSV output needs:
+// dates and times in ISO 8601, percentages and fixed decimals. Everything
+// else, currencies, fractions, scientific notation, stays General and is
+// written like an unformatted number.
+class NumberFormat {
+public:
+  enum class Kind : std::uint8_t {
+    General,
+    Date,     // 2024-03-11
+    Time,     // 13:05:09
+    DateTime, // 2024-03-11T13:05:09
+    Duration, // [h]:mm:ss, hours past 24
+    Percent,
+    Fixed,
+  };
+
+  // Decimals beyond this are dropped, keeps the output in kMaxNumberLength
+  static constexpr std::uint8_t kMaxDecimals = 10;
+
+private:
+  Kind m_kind = Kind::General;
+  std::uint8_t m_decimals = 0;
+
+public:
+  constexpr NumberFormat() = default;
+  constexpr NumberFormat(Kind kind, std::uint8_t decimals = 0)
+      : m_kind(kind), m_decimals(decimals) {}
+
+  // One of the formats every workbook has without listing it in <numFmts>
+  static NumberFormat builtIn(std::uint32_t numFmtId);
+  // Classifies a format code such as "yyyy-mm-dd" or "0.00%" by its first
+  // section, the one positive numbers use
+  static NumberFormat compile(std::string_view formatCode);
+
+  Kind kind() const { return m_kind; }
+  std::uint8_t decimals() const { return m_decimals; }
+  bool operator==(const NumberFormat &other) const = default;
+
+  // Writes `number` into `buffer`, which holds kMaxNumberLength chars, and
+  // returns the end. Dates and times read `number` as a serial of the 1900
+  // date system; out of range serials are written like General.
+  char *write(double number, char *buffer) const;
+};
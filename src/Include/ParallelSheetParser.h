@@ -0,0 +1,84 @@
+#pragma once
+
+#ifdef EXCEL2CSV_THREADS
+
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ExcelReader.h"
+#include "RowBatch.h"
+#include "StringTableReader.h"
+#include "ThreadPool.h"
+#include "XmlParser.h"
+
+// Parses one worksheet on a pool of threads. The inflated <sheetData> is cut
+// into segments of about `segmentSize` bytes right before a `<row`, and each
+// segment gets its own parser, seeded as if it had just read <sheetData>.
+// Rows are handed out in document order. At most two segments per thread are
+// queued or being parsed, so memory stays bounded by the segment size.
+//
+// The cuts are speculative: a `<row` inside a comment or processing
+// instruction leaves the previous segment with unterminated markup, which its
+// parser reports. feed() or finish() then return false and the caller is
+// expected to re-read the sheet sequentially.
+class ParallelSheetParser {
+private:
+  using SegmentRows = std::optional<RowBatch>;
+
+  StringTableReader &m_stringTableReader;
+  // Copied into every segment's parser
+  ExcelRowBuilder m_rowBuilder;
+  SheetParserKind m_parser;
+  std::size_t m_segmentSize;
+
+  // Input not yet cut into a segment
+  std::string m_pending;
+  // Where to resume looking for </sheetData> in m_pending
+  std::size_t m_endSearchFrom = 0;
+  bool m_inSheetData = false;
+  bool m_done = false;
+  bool m_failed = false;
+
+  std::deque<std::future<SegmentRows>> m_inFlight;
+  RowBatch m_rows;
+  ThreadPool m_pool;
+
+  bool scanPrologue();
+  void cutSegments();
+  void submit(std::string segment);
+  void collect(bool wait);
+  void collectFront();
+  SegmentRows parseSegment(std::string_view segment) const;
+
+public:
+  static constexpr std::size_t kDefaultSegmentSize = 4 * 1024 * 1024;
+
+  ParallelSheetParser(StringTableReader &stringTableReader,
+                      ExcelRowBuilder rowBuilder, SheetParserKind parser,
+                      std::size_t threads,
+                      std::size_t segmentSize = kDefaultSegmentSize);
+
+  // Takes the next inflated chunk of the sheet, blocking while too many
+  // segments are in flight. Returns false once a segment failed to parse;
+  // rows before it stay available.
+  bool feed(std::span<const std::byte> chunk);
+
+  // Waits for the remaining segments. Returns false if one failed or the
+  // input ended before </sheetData>.
+  bool finish();
+
+  // True once </sheetData> was seen, later input isn't needed
+  bool isDone() const { return m_done; }
+
+  // See RowBatch::takeCompleted()
+  void extractCompletedRows(RowBatch &rows);
+  RowBatch extractCompletedRows();
+};
+
+#endif
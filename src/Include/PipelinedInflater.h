@@ -0,0 +1,48 @@
+#pragma once
+
+#ifdef EXCEL2CSV_THREADS
+
+#include <cstddef>
+#include <exception>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "SpscRing.h"
+#include "ZipArchive.h"
+
+// Runs a ZipEntryReader on a background thread, inflating ahead into a small
+// ring of reusable buffers while the caller parses the previous ones. Memory
+// stays bounded by ring size * chunk size.
+class PipelinedInflater {
+private:
+  struct Chunk {
+    std::vector<std::byte> buffer;
+    std::size_t size = 0;
+    bool last = false;
+    std::exception_ptr error;
+  };
+
+  static constexpr std::size_t kRingSize = 4;
+
+  ZipEntryReader &m_reader;
+  std::size_t m_chunkSize;
+  SpscRing<Chunk, kRingSize> m_ring;
+  bool m_holdingChunk = false;
+  bool m_done = false;
+  std::thread m_producer;
+
+  void produce();
+
+public:
+  PipelinedInflater(ZipEntryReader &reader, std::size_t chunkSize);
+  PipelinedInflater(const PipelinedInflater &) = delete;
+  PipelinedInflater &operator=(const PipelinedInflater &) = delete;
+  ~PipelinedInflater();
+
+  // Blocks until the next chunk is inflated, empty once the entry is
+  // exhausted. The returned view stays valid until the following call.
+  std::span<const std::byte> next();
+};
+
+#endif
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "RowBatch.h"
+
+class StringTableReader;
+
+// Rows of a sheet stored column by column, for consumers that process many
+// rows per call. Every column has one typed vector and a validity bitmap,
+// a null being a missing or empty cell. A column is Number if all its other
+// cells are numbers, Boolean if all are booleans and String otherwise; mixed
+// columns get their numbers and booleans written the way the CSV writer
+// does. Number formats aren't applied, dates stay serials.
+class RecordBatch {
+public:
+  class Column {
+  public:
+    enum class Type : std::uint8_t { Null, Number, Boolean, String };
+
+  private:
+    Type m_type = Type::Null;
+    std::size_t m_size = 0;
+    // Bit `row % 64` of word `row / 64` is set for valid rows
+    std::vector<std::uint64_t> m_validity;
+    std::vector<double> m_numbers;
+    std::vector<std::uint8_t> m_booleans;
+    // String `row` is m_bytes[m_offsets[row], m_offsets[row + 1])
+    std::vector<std::uint32_t> m_offsets;
+    std::string m_bytes;
+
+    friend class RecordBatch;
+    void fill(std::span<const std::span<const ExcelCell>> rows,
+              std::size_t column, const StringTableReader &sharedStrings);
+
+  public:
+    Type type() const { return m_type; }
+    std::size_t size() const { return m_size; }
+    bool isValid(std::size_t row) const {
+      return (m_validity[row / 64] >> (row % 64) & 1) != 0;
+    }
+    std::span<const std::uint64_t> validity() const { return m_validity; }
+
+    // Values of Number and Boolean columns, 0 for nulls
+    std::span<const double> numbers() const { return m_numbers; }
+    std::span<const std::uint8_t> booleans() const { return m_booleans; }
+
+    // Values of String columns, empty for nulls
+    std::span<const std::uint32_t> offsets() const { return m_offsets; }
+    std::string_view bytes() const { return m_bytes; }
+    std::string_view string(std::size_t row) const {
+      return std::string_view(m_bytes).substr(
+          m_offsets[row], m_offsets[row + 1] - m_offsets[row]);
+    }
+  };
+
+private:
+  std::size_t m_rowCount = 0;
+  std::vector<Column> m_columns;
+
+public:
+  // Transposes `rows`, resolving shared strings in `sharedStrings`. There are
+  // as many columns as cells in the widest row. Throws std::length_error if
+  // a column's text doesn't fit 32-bit offsets, 4 GiB.
+  static RecordBatch
+  fromRows(std::span<const std::span<const ExcelCell>> rows,
+           const StringTableReader &sharedStrings);
+  // Same for the completed rows of `rows`
+  static RecordBatch fromRows(const RowBatch &rows,
+                              const StringTableReader &sharedStrings);
+
+  std::size_t rowCount() const { return m_rowCount; }
+  std::size_t columnCount() const { return m_columns.size(); }
+  const Column &column(std::size_t index) const { return m_columns[index]; }
+};
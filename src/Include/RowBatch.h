@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "Arena.h"
+#include "ExcelCell.h"
+#include "ExcelValue.h"
+
+class StringTableReader;
+
+// Rows of ExcelCells stored back to back, plus the bytes of their string
+// cells in an Arena owned by the batch. Moving a batch keeps the cells valid,
+// the arena's blocks don't move.
+//
+// Cells after the last completed row make up the open row, the one a parser
+// is still filling. takeCompleted() hands out everything before it.
+//
+// clear() keeps the cells' capacity and the arena's blocks. Parsers and
+// ExcelReader pass two batches back and forth with takeCompleted(into), so
+// after the first few rounds filling a batch doesn't allocate.
+class RowBatch {
+private:
+  std::vector<ExcelCell> m_cells;
+  // End of each completed row in m_cells
+  std::vector<std::size_t> m_rowEnds;
+  Arena m_strings;
+
+  std::size_t openRowStart() const {
+    return m_rowEnds.empty() ? 0 : m_rowEnds.back();
+  }
+  // Copies the bytes of a string or number text cell into the batch
+  ExcelCell own(ExcelCell cell);
+
+public:
+  class Iterator {
+  private:
+    const RowBatch *m_batch;
+    std::size_t m_row;
+
+  public:
+    Iterator(const RowBatch *batch, std::size_t row)
+        : m_batch(batch), m_row(row) {}
+    std::span<const ExcelCell> operator*() const { return (*m_batch)[m_row]; }
+    Iterator &operator++() {
+      ++m_row;
+      return *this;
+    }
+    bool operator==(const Iterator &other) const {
+      return m_row == other.m_row;
+    }
+  };
+
+  RowBatch() = default;
+  RowBatch(const RowBatch &other);
+  RowBatch &operator=(const RowBatch &other);
+  RowBatch(RowBatch &&) = default;
+  RowBatch &operator=(RowBatch &&) = default;
+
+  // Completed rows
+  std::size_t size() const { return m_rowEnds.size(); }
+  bool empty() const { return m_rowEnds.empty(); }
+  std::span<const ExcelCell> operator[](std::size_t row) const {
+    std::size_t begin = row == 0 ? 0 : m_rowEnds[row - 1];
+    return std::span(m_cells).subspan(begin, m_rowEnds[row] - begin);
+  }
+  Iterator begin() const { return {this, 0}; }
+  Iterator end() const { return {this, size()}; }
+
+  // Copies `text` into the batch's arena
+  std::string_view store(std::string_view text) {
+    return m_strings.store(text);
+  }
+
+  // Appends `cell` to the open row, copying its string
+  void push(ExcelCell cell) { m_cells.push_back(own(cell)); }
+  // Cells of the open row
+  std::span<ExcelCell> openRow() {
+    return std::span(m_cells).subspan(openRowStart());
+  }
+  // Overwrites cell `slot` of the open row, copying its string
+  void set(std::size_t slot, ExcelCell cell) {
+    m_cells[openRowStart() + slot] = own(cell);
+  }
+  // Replaces the open row with `width` empty cells
+  void resetOpenRow(std::size_t width);
+  void completeRow() { m_rowEnds.push_back(m_cells.size()); }
+
+  // Drops every row, the open one too, keeping the memory for reuse
+  void clear();
+
+  // Moves the completed rows into `into`, dropping what it held before and
+  // giving it this batch's storage in exchange. The open row stays.
+  void takeCompleted(RowBatch &into);
+  // Same into a new batch
+  RowBatch takeCompleted();
+  // Appends the completed rows of `other`, taking over its arena
+  void append(RowBatch &&other);
+
+  // Compatibility adapter for the variant based API, shared string cells
+  // are looked up in `sharedStrings`
+  std::vector<std::vector<ExcelValue>>
+  toValues(const StringTableReader *sharedStrings = nullptr) const;
+};
+
+// toExcelValue() resolving shared string cells in `sharedStrings`
+ExcelValue toExcelValue(const ExcelCell &cell,
+                        const StringTableReader &sharedStrings);
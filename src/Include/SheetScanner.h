@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "RowBatch.h"
+#include "StringTableReader.h"
+#include "XmlParser.h"
+#include "XmlTag.h"
+
+// Hand-written scanner for the small subset of SpreadsheetML that carries cell
+// data: <sheetData>, <row>, <c>, <v>, <f> and <is>/<t>. Tag and text
+// boundaries are located with SIMD compares instead of a general XML
+// tokenizer, and element names are classified with classifyTag().
+//
+// Everything before <sheetData> is skipped and scanning stops at
+// </sheetData>. Anything inside it the scanner
+// doesn't recognise (CDATA, DTDs, unknown elements or entities) makes feed()
+// return false, the caller is then expected to re-parse the sheet with expat.
+class SheetScanner {
+private:
+  enum class State {
+    BeforeSheetData,
+    InSheetData,
+    InRow,
+    InCell,
+    InValue,
+    InFormula,
+    InInlineString,
+    InInlineText,
+    Done,
+  };
+
+  StringTableReader &m_stringTableReader;
+  State m_state = State::BeforeSheetData;
+  bool m_unsupported = false;
+  bool m_sawInput = false;
+  bool m_cellHasValue = false;
+  // False for cells a column projection drops, their text isn't collected
+  bool m_cellSelected = true;
+  // Unconsumed tail of the previous chunk, an incomplete tag or reference
+  std::string m_pending;
+  CellType m_cellType = CellType::Number;
+  std::string m_cellValue;
+  ExcelRowBuilder m_currentRowBuilder;
+
+  std::size_t scan(const char *begin, const char *end);
+  const char *scanMarkup(const char *p, const char *end);
+  const char *scanReference(const char *p, const char *end);
+  void onTag(XmlTag tag, std::string_view attributes, bool isEnd,
+             bool isEmpty);
+  void beginCell(std::string_view attributes);
+  void completeRow();
+  void pushCellValue();
+  void endCell();
+  void checkDeclaration(std::string_view declaration);
+  bool collectsText() const {
+    return m_state != State::InFormula && m_cellSelected;
+  }
+
+public:
+  explicit SheetScanner(StringTableReader &stringTableReader,
+                        ExcelRowBuilder rowBuilder = {})
+      : m_stringTableReader(stringTableReader),
+        m_currentRowBuilder(std::move(rowBuilder)) {
+    m_currentRowBuilder.setSharedStrings(m_stringTableReader);
+  }
+
+  const ExcelRowBuilder &rowBuilder() const { return m_currentRowBuilder; }
+
+  // Scans the next chunk of the sheet. Returns false once unsupported markup
+  // was met; rows completed so far stay available.
+  bool feed(std::span<const std::byte> chunk);
+
+  // Returns false if the input ended before </sheetData>, or before the last
+  // row of a limited range, or mid-markup.
+  bool finish();
+
+  bool isDone() const { return m_state == State::Done; }
+
+  // See RowBatch::takeCompleted()
+  void extractCompletedRows(RowBatch &rows) {
+    m_currentRowBuilder.extractCompletedRows(rows);
+  }
+  RowBatch extractCompletedRows() {
+    return m_currentRowBuilder.extractCompletedRows();
+  }
+};
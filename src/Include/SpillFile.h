@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Append-only temporary file for data that doesn't fit the memory budget.
+// It's unlinked right after it's created, so it goes away with the process
+// however that ends. Bytes are appended through a small buffer and read back
+// through a read-only mapping once map() was called.
+class SpillFile {
+private:
+  int m_fd = -1;
+  // Appended but not written yet
+  std::string m_pending;
+  std::uint64_t m_size = 0;
+  const char *m_mapping = nullptr;
+  std::size_t m_mappedSize = 0;
+
+  void flush();
+  void release();
+
+public:
+  // Creates the file in the system's temporary directory, throws
+  // std::runtime_error if that fails.
+  SpillFile();
+  SpillFile(const SpillFile &) = delete;
+  SpillFile &operator=(const SpillFile &) = delete;
+  SpillFile(SpillFile &&other) noexcept;
+  SpillFile &operator=(SpillFile &&other) noexcept;
+  ~SpillFile();
+
+  // Appends `bytes`, returns their offset
+  std::uint64_t append(std::string_view bytes);
+  // Bytes appended so far
+  std::uint64_t size() const { return m_size; }
+
+  // Maps everything appended so far, replacing an earlier mapping
+  void map();
+  // Bytes at `offset`, which have to be mapped
+  std::string_view view(std::uint64_t offset, std::size_t size) const {
+    return {m_mapping + offset, size};
+  }
+};
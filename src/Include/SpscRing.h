@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded single-producer/single-consumer ring of reusable slots. The
+// producer fills slots in place and publishes them, the consumer reads them
+// in place and hands them back, so nothing is copied or allocated while
+// items flow through. Blocking waits park on the counters themselves
+// (std::atomic::wait) instead of a mutex.
+template <typename T, std::size_t Capacity> class SpscRing {
+private:
+  std::array<T, Capacity> m_slots{};
+  // Monotonic counters, slot index is counter % Capacity
+  alignas(64) std::atomic<std::size_t> m_written{0};
+  alignas(64) std::atomic<std::size_t> m_read{0};
+  std::atomic<bool> m_closed{false};
+
+public:
+  // Producer side: waits for a free slot, nullptr once the ring was closed.
+  T *acquireWrite() {
+    std::size_t written = m_written.load(std::memory_order_relaxed);
+    while (true) {
+      if (m_closed.load(std::memory_order_acquire)) {
+        return nullptr;
+      }
+      std::size_t read = m_read.load(std::memory_order_acquire);
+      if (written - read < Capacity) {
+        return &m_slots[written % Capacity];
+      }
+      m_read.wait(read, std::memory_order_acquire);
+    }
+  }
+
+  void commitWrite() {
+    m_written.fetch_add(1, std::memory_order_release);
+    m_written.notify_one();
+  }
+
+  // Consumer side: waits for a published slot.
+  T *acquireRead() {
+    std::size_t read = m_read.load(std::memory_order_relaxed);
+    while (true) {
+      std::size_t written = m_written.load(std::memory_order_acquire);
+      if (written != read) {
+        return &m_slots[read % Capacity];
+      }
+      m_written.wait(written, std::memory_order_acquire);
+    }
+  }
+
+  void releaseRead() {
+    m_read.fetch_add(1, std::memory_order_release);
+    m_read.notify_one();
+  }
+
+  // Wakes a producer blocked in acquireWrite, used when the consumer stops
+  // early.
+  void close() {
+    m_closed.store(true, std::memory_order_release);
+    // Bump the counter the producer is parked on so its wait returns
+    m_read.fetch_add(1, std::memory_order_release);
+    m_read.notify_one();
+  }
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <type_traits>
+#include <utility>
+
+// Fixed-capacity array on address space reserved up front. Pages are only
+// backed by memory once written, so a generous capacity costs nothing, and
+// elements never move: another thread can keep reading what was published
+// while the array grows.
+template <typename T> class StableArray {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+private:
+  T *m_data = nullptr;
+  std::size_t m_size = 0;
+  std::size_t m_capacity = 0;
+
+  void release() {
+    if (m_data != nullptr) {
+      munmap(m_data, m_capacity * sizeof(T));
+      m_data = nullptr;
+    }
+  }
+
+public:
+  StableArray() = default;
+  // Throws std::runtime_error if the address space can't be reserved
+  explicit StableArray(std::size_t capacity) : m_capacity(capacity) {
+    if (capacity == 0) {
+      return;
+    }
+    void *data = mmap(nullptr, capacity * sizeof(T), PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (data == MAP_FAILED) {
+      throw std::runtime_error(
+          std::format("Failed to reserve {} bytes", capacity * sizeof(T)));
+    }
+    m_data = static_cast<T *>(data);
+  }
+  StableArray(const StableArray &) = delete;
+  StableArray &operator=(const StableArray &) = delete;
+  StableArray(StableArray &&other) noexcept
+      : m_data(std::exchange(other.m_data, nullptr)),
+        m_size(std::exchange(other.m_size, 0)),
+        m_capacity(std::exchange(other.m_capacity, 0)) {}
+  StableArray &operator=(StableArray &&other) noexcept {
+    if (this != &other) {
+      release();
+      m_data = std::exchange(other.m_data, nullptr);
+      m_size = std::exchange(other.m_size, 0);
+      m_capacity = std::exchange(other.m_capacity, 0);
+    }
+    return *this;
+  }
+  ~StableArray() { release(); }
+
+  // Both have to fit the capacity
+  void push_back(T value) {
+    assert(m_size < m_capacity);
+    m_data[m_size++] = value;
+  }
+  void append(const T *values, std::size_t count) {
+    assert(count <= m_capacity - m_size);
+    if (count > 0) {
+      std::memcpy(m_data + m_size, values, count * sizeof(T));
+      m_size += count;
+    }
+  }
+
+  const T *data() const { return m_data; }
+  const T &operator[](std::size_t index) const { return m_data[index]; }
+  std::size_t size() const { return m_size; }
+  std::size_t capacity() const { return m_capacity; }
+  bool empty() const { return m_size == 0; }
+};
@@ -1,25 +1,185 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <expat.h>
-#include <minizip/unzip.h>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#ifdef EXCEL2CSV_THREADS
+#include <atomic>
+#include <exception>
+#include <thread>
+#endif
+
+#include "CsvField.h"
+#include "LazyStringTable.h"
+#include "SpillFile.h"
+#include "StableArray.h"
+#include "Utils.h"
+#include "ZipArchive.h"
+
+// The workbook's shared strings. They're kept in memory up to a budget,
+// the ones after that are appended to a SpillFile and read back through
+// its mapping, so huge tables don't take huge amounts of memory. In lazy
+// mode strings are only decoded once they're looked up, see LazyStringTable.
+// collectInBackground() lets the sheet be parsed while the strings are.
 class StringTableReader {
 private:
-  std::vector<std::string> string_table;
+  static constexpr std::size_t kCollected = SIZE_MAX;
+  static constexpr std::size_t kFailed = SIZE_MAX - 1;
+
+#ifdef EXCEL2CSV_THREADS
+  // Shared with the thread of collectInBackground(), on the heap so the
+  // reader stays movable
+  struct Collection {
+    // In-memory strings ready to be read while collecting, kCollected or
+    // kFailed once collection ended
+    std::atomic<std::size_t> ready{kCollected};
+    std::atomic<bool> stop{false};
+    std::exception_ptr error;
+    std::thread thread;
+
+    ~Collection();
+  };
+  // First, so assigning to the reader stops its collection before anything
+  // the thread writes to is replaced
+  std::unique_ptr<Collection> collection;
+  // The collection the thread publishes to, only touched by that thread
+  Collection *publishing = nullptr;
+
+  bool isCollecting() const {
+    return collection->ready.load(std::memory_order_acquire) != kCollected;
+  }
+  bool waitForString(std::size_t stringIndex) const;
+#else
+  bool isCollecting() const { return false; }
+#endif
+
+  // In-memory strings back to back, string i is at string_offsets[i] up to
+  // string_offsets[i + 1]. Sized from the XML, so they never move
+  StableArray<char> string_pool;
+  StableArray<std::uint64_t> string_offsets;
+  // How each string is written to CSV, worked out once while collecting so
+  // the writer doesn't scan strings it writes over and over
+  StableArray<CsvQuoting> string_quoting;
+  std::size_t memory_budget;
+  std::size_t memory_used = 0;
+  // Strings past the budget, string i is at spill_offsets[i] up to
+  // spill_offsets[i + 1]
+  std::optional<SpillFile> spill_file;
+  std::vector<std::uint64_t> spill_offsets;
+  std::vector<CsvQuoting> spill_quoting;
+  bool lazy;
+  // Set after collect() in lazy mode
+  std::unique_ptr<LazyStringTable> lazy_strings;
+
   std::string current_string;
   bool in_string_item = false;
   bool in_text_element = false;
 
+  // True once string `stringIndex` is ready while still collecting, false
+  // once collection ended. Rethrows what made a background collection fail
+  bool awaitString([[maybe_unused]] std::size_t stringIndex) const {
+#ifdef EXCEL2CSV_THREADS
+    if (isCollecting()) {
+      return waitForString(stringIndex);
+    }
+#endif
+    return false;
+  }
+
   static void XMLCALL startElement(void *userData, const char *name,
                                    const char **atts);
   static void XMLCALL endElement(void *userData, const char *name);
   static void XMLCALL charDataHandler(void *userData, const char *s, int len);
 
+  void addString(const std::string &text);
+  void reserve(std::uint64_t xmlSize);
+
 public:
-  void collect(unzFile excelFileRef);
-  std::optional<std::string> getStringEntry(std::size_t stringIndex);
+  static constexpr std::size_t kDefaultMemoryBudget = 256 * 1024 * 1024;
+
+  // In `lazy` mode the budget bounds the cache of decoded strings
+  explicit StringTableReader(std::size_t memoryBudget = kDefaultMemoryBudget,
+                             bool lazy = false)
+      : memory_budget(memoryBudget), lazy(lazy) {
+#ifdef EXCEL2CSV_THREADS
+    collection = std::make_unique<Collection>();
+#endif
+  }
+  StringTableReader(StringTableReader &&) = default;
+  StringTableReader &operator=(StringTableReader &&) = default;
+  // Stops a background collection before the strings go
+  ~StringTableReader();
+
+  void collect(const ZipArchive &excelArchive, ZipReadOptions zipOptions = {});
+  void collect(const ZipArchive &excelArchive, std::vector<std::byte> &buffer,
+               ZipReadOptions zipOptions = {});
+#ifdef EXCEL2CSV_THREADS
+  // Collects on a thread of its own, reading from its own handle on the
+  // workbook. Lookups meanwhile wait for the strings they need, see
+  // hasStringEntry(). Lazy tables are indexed before this returns. The reader
+  // mustn't be moved until collection ended.
+  void collectInBackground(ZipArchive excelArchive,
+                           ZipReadOptions zipOptions = {});
+#endif
+  // Waits for a background collection to end and rethrows what made it
+  // fail, if anything. Returns right away otherwise
+  void finishCollecting();
+
+  // Whether `stringIndex` is in the table. While collecting in the background
+  // this waits until that string is ready or collection ended.
+  bool hasStringEntry(std::size_t stringIndex) const {
+    return awaitString(stringIndex) || stringIndex < size();
+  }
+  // String at `stringIndex`, for which hasStringEntry() has to be true. Valid
+  // as long as the reader, in lazy mode only until the next lookup.
+  std::string_view getStringEntry(std::size_t stringIndex) const {
+    if (lazy_strings) {
+      return lazy_strings->get(stringIndex);
+    }
+    // Only in-memory strings are ready before collection ended
+    if (isCollecting() || stringIndex < inMemoryCount()) {
+      std::uint64_t begin = string_offsets[stringIndex];
+      return {string_pool.data() + begin,
+              string_offsets[stringIndex + 1] - begin};
+    }
+    std::size_t spilled = stringIndex - inMemoryCount();
+    std::uint64_t begin = spill_offsets[spilled];
+    return spill_file->view(begin, spill_offsets[spilled + 1] - begin);
+  }
+  // How the string at `stringIndex` is written to CSV, same preconditions
+  CsvQuoting csvQuoting(std::size_t stringIndex) const {
+    if (lazy_strings) {
+      return lazy_strings->csvQuoting(stringIndex);
+    }
+    if (isCollecting() || stringIndex < inMemoryCount()) {
+      return string_quoting[stringIndex];
+    }
+    return spill_quoting[stringIndex - inMemoryCount()];
+  }
+  // Same as getStringEntry(), or std::nullopt for indices past the table
+  std::optional<std::string_view>
+  viewStringEntry(std::size_t stringIndex) const;
+  // Number of strings, waits for a background collection to end
+  std::size_t size() const {
+    awaitString(kCollected);
+    return lazy_strings ? lazy_strings->size()
+                        : inMemoryCount() + spilledCount();
+  }
+  // These two are only final once collection ended
+  std::size_t inMemoryCount() const {
+    return string_offsets.empty() ? 0 : string_offsets.size() - 1;
+  }
+  // Strings that didn't fit the memory budget
+  std::size_t spilledCount() const {
+    return spill_offsets.empty() ? 0 : spill_offsets.size() - 1;
+  }
+  // Whether strings are decoded on demand, lazy mode can fall back to
+  // decoding them all
+  bool isLazy() const { return lazy_strings != nullptr; }
 };
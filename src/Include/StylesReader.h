@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expat.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "NumberFormat.h"
+#include "Utils.h"
+#include "ZipArchive.h"
+
+// Number formats of the cell styles in xl/styles.xml. A cell's s attribute
+// indexes <cellXfs>; formatOf() turns it into an index into the formats,
+// compiled once per workbook, that the CSV writer applies.
+class StylesReader {
+private:
+  // Distinct formats, General first
+  std::vector<NumberFormat> m_formats{NumberFormat()};
+  // Format index of every <cellXfs> entry
+  std::vector<std::uint32_t> m_styleFormats;
+  // Format codes of the <numFmts> entries by numFmtId
+  std::unordered_map<std::uint32_t, std::string> m_formatCodes;
+  bool m_inCellXfs = false;
+
+  static void XMLCALL startElement(void *userData, const char *name,
+                                   const char **atts);
+  static void XMLCALL endElement(void *userData, const char *name);
+
+  std::uint32_t addFormat(NumberFormat format);
+
+public:
+  // Workbooks without xl/styles.xml have nothing but General
+  void collect(const ZipArchive &excelArchive, std::vector<std::byte> &buffer,
+               ZipReadOptions zipOptions = {});
+
+  // Index of the format of cell style `style`, 0 for General
+  std::uint32_t formatOf(std::uint32_t style) const {
+    return style < m_styleFormats.size() ? m_styleFormats[style] : 0;
+  }
+  const NumberFormat &format(std::uint32_t index) const {
+    return m_formats[index];
+  }
+  std::size_t styleCount() const { return m_styleFormats.size(); }
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads running submitted jobs in FIFO order. Jobs
+// still queued when the pool is destroyed are dropped, running ones are
+// waited for.
+class ThreadPool {
+private:
+  std::vector<std::thread> m_workers;
+  std::deque<std::function<void()>> m_jobs;
+  std::mutex m_mutex;
+  std::condition_variable m_wakeUp;
+  bool m_stopping = false;
+
+  void work() {
+    while (true) {
+      std::function<void()> job;
+      {
+        std::unique_lock lock(m_mutex);
+        m_wakeUp.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+        if (m_stopping) {
+          return;
+        }
+        job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+      }
+      job();
+    }
+  }
+
+public:
+  explicit ThreadPool(std::size_t threads) {
+    for (std::size_t i = 0; i < threads; ++i) {
+      m_workers.emplace_back(&ThreadPool::work, this);
+    }
+  }
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard lock(m_mutex);
+      m_stopping = true;
+      m_jobs.clear();
+    }
+    m_wakeUp.notify_all();
+    for (auto &worker : m_workers) {
+      worker.join();
+    }
+  }
+
+  std::size_t size() const { return m_workers.size(); }
+
+  // Queues `job`, its result or exception is handed over through the future.
+  template <typename Job>
+  std::future<std::invoke_result_t<Job>> submit(Job job) {
+    using Result = std::invoke_result_t<Job>;
+    // std::function needs a copyable callable, the task itself is move-only
+    auto task =
+        std::make_shared<std::packaged_task<Result()>>(std::move(job));
+    auto result = task->get_future();
+    {
+      std::lock_guard lock(m_mutex);
+      m_jobs.emplace_back([task] { (*task)(); });
+    }
+    m_wakeUp.notify_one();
+    return result;
+  }
+};
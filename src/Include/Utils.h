@@ -1,11 +1,14 @@
+#pragma once
+
 #include <cstddef>
-#include <minizip/unzip.h>
 #include <optional>
 #include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <vector>
 
+#include "ZipArchive.h"
 #include "generator.h"
 
 class MalformedZipFileException : public std::runtime_error {
@@ -20,18 +23,47 @@ public:
       : std::runtime_error(msg) {}
 };
 
+struct ZipReadOptions {
+  InflateBackend inflateBackend = InflateBackend::Zlib;
+  // Inflate on a background thread while the caller consumes chunks, needs a
+  // build with `-Dthreads=true`
+  bool pipelined = false;
+  // Bytes handed to the consumer per chunk, 0 picks one from the entry's
+  // uncompressed size (see ZipUtils::chunkSizeFor)
+  std::size_t chunkSize = 0;
+};
+
 class ZipUtils {
 public:
-  static std::optional<unzFile> open(std::string_view filePath) {
-    unzFile file = unzOpen(filePath.data());
-    if (file == nullptr) {
-      return std::nullopt;
-    }
-    return file;
+  static std::optional<ZipArchive> open(std::string_view filePath) {
+    return ZipArchive::open(filePath);
   }
 
-  static generator<std::span<std::byte>>
-  readFileChunked(unzFile file, std::string_view zipEntry);
+  // Deflated entries are inflated into a reused buffer; stored entries are
+  // yielded as views straight over the mapped archive.
+  static generator<std::span<const std::byte>>
+  readFileChunked(const ZipArchive &archive, std::string_view zipEntry,
+                  ZipReadOptions options = {});
+
+  // Same as above, inflating into the caller's buffer so it can be reused
+  // across entries. The buffer only ever grows to the chunk size in use.
+  static generator<std::span<const std::byte>>
+  readFileChunked(const ZipArchive &archive, std::string_view zipEntry,
+                  std::vector<std::byte> &buffer, ZipReadOptions options = {});
+
+  // Same as above for an entry the caller already opened.
+  static generator<std::span<const std::byte>>
+  readFileChunked(ZipEntryReader &reader, std::vector<std::byte> &buffer,
+                  ZipReadOptions options = {});
+
+  // Adaptive chunk size: 64 KiB for small entries, growing with the entry so
+  // multi-hundred-MB sheets are parsed in 1 MiB steps.
+  static std::size_t chunkSizeFor(std::uint64_t uncompressedSize);
+
+  // Chunk size readFileChunked uses for `entry`: the requested one, capped so
+  // it fits expat's int lengths, or chunkSizeFor() when none was requested.
+  static std::size_t chunkSizeFor(const ZipEntry &entry,
+                                  ZipReadOptions options);
 };
 
 int stringToNumber(const std::string &str);
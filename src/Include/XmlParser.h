@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ColumnSelection.h"
+#include "ExcelCell.h"
+#include "RowBatch.h"
+#include "StringTableReader.h"
+#include "StylesReader.h"
+#include "Utils.h"
+#include "XmlParserState.h"
+#include "ZipArchive.h"
+#include "expat.h"
+#include "generator.h"
+
+struct XmlParserDeleter {
+  void operator()(XML_Parser parser) const { XML_ParserFree(parser); }
+};
+
+// Owning handle, frees the parser however the caller's scope is left
+using XmlParserHandle = std::unique_ptr<XML_ParserStruct, XmlParserDeleter>;
+
+// Allocates an expat parser, throws std::runtime_error on failure.
+XmlParserHandle createXmlParser();
+
+// Parses the ZIP entry `zipEntry` with `parser` to the end of the document,
+// yielding the number of bytes parsed after every chunk so callers can drain
+// what their handlers collected. Ends early, closing the entry, when a
+// handler calls XML_StopParser. Throws MalformedExcelFileException on
+// malformed XML.
+generator<std::size_t> parseZipEntry(XML_Parser parser,
+                                     const ZipArchive &archive,
+                                     std::string_view zipEntry,
+                                     std::vector<std::byte> &buffer,
+                                     ZipReadOptions options);
+
+// Cell for the text of a <v>. Shared strings stay an index into the table,
+// other strings point into `cellValue`. With `numberText` numbers point into
+// it too, as NumberText cells.
+ExcelCell createExcelCell(const StringTableReader &stringTableReader,
+                          CellType cellType, const std::string &cellValue,
+                          bool numberText = false);
+
+// Collects rows of cells into a RowBatch. Without a projection cells are
+// appended in document order; with one every row has one slot per selected
+// column, empty unless a cell of that column was pushed.
+class ExcelRowBuilder {
+private:
+  // Completed rows and the one being built
+  RowBatch rows;
+  bool is_done = false;
+
+  std::optional<ColumnSelection> selection;
+  // Set by projectByHeader() until the first row resolves them
+  std::vector<std::string> header_names;
+  std::vector<std::uint32_t> header_columns;
+  std::vector<std::string> missing_headers;
+
+  bool keep_number_text = false;
+  // Number formats of the cell styles, see applyNumberFormats()
+  const StylesReader *styles = nullptr;
+  std::uint32_t cell_format = 0;
+
+  std::uint32_t next_column = 0;
+  std::size_t cell_slot = 0;
+  bool cell_wanted = true;
+
+  // Row range, see limitRows()
+  std::size_t rows_seen = 0;
+  std::size_t rows_kept = 0;
+  std::size_t skip_rows = 0;
+  std::size_t max_rows = SIZE_MAX;
+
+  // Resolves the header row's shared string cells, set by the parsers
+  const StringTableReader *shared_strings = nullptr;
+
+  std::optional<std::string_view> headerText(const ExcelCell &cell) const;
+  void resolveHeader();
+
+public:
+  // Keeps only the cells of `columns`.
+  void project(ColumnSelection columns);
+  // Keeps only the columns whose header, the first row's cell, is one of
+  // `names`. The first row itself is projected too.
+  void projectByHeader(std::vector<std::string> names);
+  void setSharedStrings(const StringTableReader &sharedStrings) {
+    this->shared_strings = &sharedStrings;
+  }
+
+  // Keeps numbers as their text, see ExcelCell::numberText()
+  void keepNumberText() { this->keep_number_text = true; }
+  bool keepsNumberText() const { return this->keep_number_text; }
+
+  // Gives number cells the number format of their style, see
+  // ExcelCell::numberFormat()
+  void applyNumberFormats(const StylesReader &styles) {
+    this->styles = &styles;
+  }
+  // True if parsers have to pass each cell's style to beginCell()
+  bool needsStyles() const { return this->styles != nullptr; }
+
+  // Keeps only `maxRows` rows after the first `skipRows` of the sheet.
+  void limitRows(std::size_t skipRows, std::optional<std::size_t> maxRows);
+  // False for rows before the range. Their cells aren't wanted and reset()
+  // drops them.
+  bool isRowWanted() const { return this->rows_seen >= this->skip_rows; }
+  // True once the last row of the range was built, parsing can stop
+  bool isExhausted() const { return this->rows_kept >= this->max_rows; }
+
+  // True if parsers have to pass each cell's column to beginCell()
+  bool needsColumns() const {
+    return selection.has_value() || !header_names.empty();
+  }
+  // Header names the first row didn't contain
+  const std::vector<std::string> &missingHeaders() const {
+    return missing_headers;
+  }
+
+  // Starts a cell, `column` comes from its `r` attribute and defaults to the
+  // one after the previous cell, `style` from its `s` attribute. Returns false
+  // if the cell is projected away, its value then doesn't need to be built
+  // and push() drops it.
+  bool beginCell(std::optional<std::uint32_t> column = std::nullopt,
+                 std::uint32_t style = 0);
+  // Adds the current cell, copying the bytes of a string cell
+  void push(ExcelCell cell);
+  void seal() { this->is_done = true; }
+  bool isBuilt() const { return this->is_done == true; }
+  // Completes the sealed row, keeping it if it's in the row range
+  void reset();
+
+  void extractCompletedRows(RowBatch &completed) {
+    this->rows.takeCompleted(completed);
+  }
+  RowBatch extractCompletedRows() { return this->rows.takeCompleted(); }
+};
+
+// Expat driven state machine turning a worksheet's <sheetData> into rows.
+class XmlParser {
+private:
+  XmlParserState m_state;
+
+  StringTableReader &stringTableReader;
+  ExcelRowBuilder m_currentRowBuilder;
+  // Set by attach(), stopped after </sheetData> or the row range's last row
+  XML_Parser m_parser = nullptr;
+
+  void completeRow();
+  void stop();
+
+public:
+  XmlParser(StringTableReader &stringTableParser,
+            ExcelRowBuilder rowBuilder = {})
+      : stringTableReader(stringTableParser),
+        m_currentRowBuilder(std::move(rowBuilder)) {
+    m_currentRowBuilder.setSharedStrings(stringTableReader);
+  }
+
+  const ExcelRowBuilder &rowBuilder() const { return m_currentRowBuilder; }
+  bool isDone() const {
+    return m_state.phase == XmlParserState::Phase::Done;
+  }
+
+  void onElementStart(const char *name, const char **atts);
+  void onElementEnd(const char *name);
+  void onCharacterData(const char *s, int len);
+
+  // See RowBatch::takeCompleted()
+  void extractCompletedRows(RowBatch &rows) {
+    m_currentRowBuilder.extractCompletedRows(rows);
+  }
+  RowBatch extractCompletedRows() {
+    return m_currentRowBuilder.extractCompletedRows();
+  }
+
+  // Registers the callbacks forwarding expat events to this parser
+  void attach(XML_Parser parser);
+};
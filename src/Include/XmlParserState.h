@@ -1,18 +1,61 @@
+#pragma once
+
+#include <cstdint>
 #include <string>
-#include <variant>
+#include <string_view>
 
-struct WaitingForSheetData {};
-struct WaitingForRow {};
-struct WaitingForCell {};
-struct WaitingForValue {
-  std::string cellType;
+// A cell's `t` attribute, narrowed to one char. Values excel2csv doesn't know
+// about are read as numbers, like cells without the attribute.
+enum class CellType : char {
+  Number = 'n',
+  SharedString = 's',
+  Boolean = 'b',
+  Error = 'e',
+  String = 'S', // t="str", formula result
+  InlineString = 'i',
+  Date = 'd',
 };
-struct InValue {
-  std::string cellType;
+
+inline CellType parseCellType(std::string_view type) {
+  if (type == "s") {
+    return CellType::SharedString;
+  }
+  if (type == "b") {
+    return CellType::Boolean;
+  }
+  if (type == "e") {
+    return CellType::Error;
+  }
+  if (type == "str") {
+    return CellType::String;
+  }
+  if (type == "inlineStr") {
+    return CellType::InlineString;
+  }
+  if (type == "d") {
+    return CellType::Date;
+  }
+  return CellType::Number;
+}
+
+// Where XmlParser is inside <sheetData>. One flat struct for all phases so a
+// transition never constructs or destroys strings: cellValue is cleared, not
+// freed, and keeps its capacity from one cell to the next.
+struct XmlParserState {
+  enum class Phase : std::uint8_t {
+    WaitingForSheetData,
+    WaitingForRow,
+    WaitingForCell,
+    WaitingForValue,
+    InValue,
+    InInlineString,
+    InInlineText,
+    Done,
+  };
+
+  Phase phase = Phase::WaitingForSheetData;
+  CellType cellType = CellType::Number;
+  // False for cells a column projection drops, their text isn't collected
+  bool cellSelected = true;
   std::string cellValue;
 };
-struct Done {};
-
-using XmlParserState =
-    std::variant<WaitingForSheetData, WaitingForRow, WaitingForCell,
-                 WaitingForValue, InValue, Done>;
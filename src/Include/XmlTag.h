@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Element names the sheet and shared string parsers react to.
+enum class XmlTag : std::uint8_t {
+  Unknown,
+  SheetData,
+  Row,
+  C,
+  V,
+  F,
+  Is,
+  T,
+  Si,
+};
+
+namespace xml_tag_detail {
+
+struct TagName {
+  std::string_view name;
+  XmlTag tag = XmlTag::Unknown;
+};
+
+inline constexpr std::array<TagName, 8> kTagNames{{
+    {"sheetData", XmlTag::SheetData},
+    {"row", XmlTag::Row},
+    {"c", XmlTag::C},
+    {"v", XmlTag::V},
+    {"f", XmlTag::F},
+    {"is", XmlTag::Is},
+    {"t", XmlTag::T},
+    {"si", XmlTag::Si},
+}};
+
+inline constexpr std::size_t kTableSize = 16;
+
+// Packs length, first and last byte into a key and keeps the top 4 bits of
+// its product with the seed.
+constexpr std::size_t hash(std::string_view name, std::uint32_t seed) {
+  std::uint32_t key = static_cast<unsigned char>(name.front()) |
+                      static_cast<unsigned char>(name.back()) << 8 |
+                      static_cast<std::uint32_t>(name.size()) << 16;
+  return static_cast<std::uint32_t>(key * seed) >> 28;
+}
+
+// First golden-ratio multiple mapping every known name to its own slot
+constexpr std::uint32_t findSeed() {
+  for (std::uint32_t i = 1; i < 1 << 12; ++i) {
+    std::uint32_t seed = i * 0x9E3779B1u;
+    std::array<bool, kTableSize> used{};
+    bool collision = false;
+    for (const auto &entry : kTagNames) {
+      auto slot = hash(entry.name, seed);
+      collision = collision || used[slot];
+      used[slot] = true;
+    }
+    if (!collision) {
+      return seed;
+    }
+  }
+  return 0;
+}
+
+inline constexpr std::uint32_t kSeed = findSeed();
+static_assert(kSeed != 0, "no collision-free seed for the XML tag table");
+
+constexpr std::array<TagName, kTableSize> buildTable() {
+  std::array<TagName, kTableSize> table{};
+  for (const auto &entry : kTagNames) {
+    table[hash(entry.name, kSeed)] = entry;
+  }
+  return table;
+}
+
+inline constexpr std::array<TagName, kTableSize> kTable = buildTable();
+
+} // namespace xml_tag_detail
+
+// One hash and one comparison per element instead of a strcmp chain.
+inline XmlTag classifyTag(std::string_view name) {
+  if (name.empty()) {
+    return XmlTag::Unknown;
+  }
+  const auto &slot =
+      xml_tag_detail::kTable[xml_tag_detail::hash(name, xml_tag_detail::kSeed)];
+  return slot.name == name ? slot.tag : XmlTag::Unknown;
+}
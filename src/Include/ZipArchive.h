@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <zlib.h>
+
+enum class InflateBackend {
+  // Streaming zlib inflate, memory stays bounded by the caller's buffer
+  Zlib,
+  // libdeflate whole-buffer decode: considerably faster, but holds the whole
+  // uncompressed entry in memory. Only available when built with
+  // `-Dlibdeflate=true`.
+  Libdeflate,
+};
+
+std::optional<InflateBackend> parseInflateBackend(std::string_view name);
+bool isInflateBackendAvailable(InflateBackend backend);
+
+struct ZipEntry {
+  std::uint16_t flags = 0;
+  std::uint16_t compressionMethod = 0;
+  std::uint64_t compressedSize = 0;
+  std::uint64_t uncompressedSize = 0;
+  std::uint64_t localHeaderOffset = 0;
+};
+
+// Read-only view of a ZIP container backed by a private memory mapping of the
+// whole file. The central directory is indexed once on open so entries can be
+// located by name without scanning, and entry payloads are handed out as spans
+// over the mapping instead of being copied through stdio buffers.
+class ZipArchive {
+private:
+  struct NameHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view name) const {
+      return std::hash<std::string_view>{}(name);
+    }
+  };
+
+  const std::byte *m_data = nullptr;
+  std::size_t m_size = 0;
+  std::unordered_map<std::string, ZipEntry, NameHash, std::equal_to<>>
+      m_entries;
+
+  ZipArchive(const std::byte *data, std::size_t size);
+  void indexCentralDirectory();
+  void release();
+
+public:
+  static std::optional<ZipArchive> open(std::string_view filePath);
+
+  ZipArchive(const ZipArchive &) = delete;
+  ZipArchive &operator=(const ZipArchive &) = delete;
+  ZipArchive(ZipArchive &&other) noexcept;
+  ZipArchive &operator=(ZipArchive &&other) noexcept;
+  ~ZipArchive();
+
+  const ZipEntry *find(std::string_view entryName) const;
+
+  // Raw (possibly compressed) bytes of the entry, located through its local
+  // file header.
+  std::span<const std::byte> entryData(const ZipEntry &entry) const;
+};
+
+// Pull-based reader over a single entry, inflating straight from the mapped
+// archive into the caller's buffer.
+class ZipEntryReader {
+private:
+  ZipEntry m_entry;
+  std::span<const std::byte> m_data;
+  std::vector<std::byte> m_decoded;
+  std::size_t m_consumed = 0;
+  z_stream m_stream{};
+  bool m_inflating = false;
+  bool m_finished = false;
+
+public:
+  ZipEntryReader(const ZipArchive &archive, std::string_view entryName,
+                 InflateBackend backend = InflateBackend::Zlib);
+  ZipEntryReader(const ZipEntryReader &) = delete;
+  ZipEntryReader &operator=(const ZipEntryReader &) = delete;
+  ~ZipEntryReader();
+
+  const ZipEntry &entry() const { return m_entry; }
+  // Entry bytes are available as one contiguous block, either because the
+  // entry is stored or because it was decoded whole-buffer.
+  bool isContiguous() const { return !m_inflating; }
+
+  // Fills up to `out.size()` bytes and returns how many were written, 0 once
+  // the entry is exhausted.
+  std::size_t read(std::span<std::byte> out);
+
+  // Contiguous entries only: hands out the next `maxBytes` of the entry as a
+  // view instead of copying, empty once the entry is exhausted.
+  std::span<const std::byte> readMapped(std::size_t maxBytes);
+};
@@ -1,5 +1,9 @@
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 
 #include "ExcelReader.h"
 #include "ExcelRow2Csv.h"
@@ -12,6 +16,58 @@ int main(int argc, char *argv[]) {
   argparse::ArgumentParser program("excel2csv");
 
   program.add_argument("xlsxpath").help("Path to the Excel file to convert");
+  program.add_argument("--parser")
+      .help("Sheet parser: fast (falls back to expat when needed) or expat")
+      .default_value(std::string("fast"));
+  program.add_argument("--inflate")
+      .help("Inflate backend: zlib or libdeflate (needs -Dlibdeflate=true)")
+      .default_value(std::string("zlib"));
+  program.add_argument("--chunk-size")
+      .help("Bytes inflated per parse step, 0 adapts to the sheet size")
+      .default_value(0)
+      .scan<'i', int>();
+  program.add_argument("--pipelined")
+      .help("Inflate on a background thread while parsing (needs "
+            "-Dthreads=true)")
+      .flag();
+  program.add_argument("--threads")
+      .help("Parse the sheet on this many threads (needs -Dthreads=true)")
+      .default_value(1)
+      .scan<'i', int>();
+  program.add_argument("--skip-rows")
+      .help("Rows of the sheet to skip before the first one converted")
+      .default_value(0)
+      .scan<'i', int>();
+  program.add_argument("--max-rows")
+      .help("Stop after converting this many rows")
+      .scan<'i', int>();
+  program.add_argument("--columns")
+      .help("Only output these columns, e.g. A,C,F:H");
+  program.add_argument("--columns-by-header")
+      .help("Only output the columns with these names in the first row, "
+            "e.g. id,name");
+  program.add_argument("--strings-budget")
+      .help("MiB of shared strings kept in memory, the rest is spilled to a "
+            "temporary file")
+      .default_value(
+          static_cast<int>(StringTableReader::kDefaultMemoryBudget >> 20))
+      .scan<'i', int>();
+  program.add_argument("--concurrent-strings")
+      .help("Parse the shared strings on a background thread while the sheet "
+            "is parsed (needs -Dthreads=true)")
+      .flag();
+  program.add_argument("--lazy-strings")
+      .help("Decode shared strings when a cell first uses them, caching up to "
+            "--strings-budget of them")
+      .flag();
+  program.add_argument("--number-formats")
+      .help("Write dates, times, percentages and fixed decimals the way the "
+            "sheet formats them, dates and times in ISO 8601")
+      .flag();
+  program.add_argument("--raw-numbers")
+      .help("Write numbers as they are stored in the sheet instead of "
+            "reformatting them")
+      .flag();
 
   try {
     program.parse_args(argc, argv);
@@ -23,12 +79,144 @@ int main(int argc, char *argv[]) {
 
   std::string xlsxPath = program.get<std::string>("xlsxpath");
 
-  ExcelReader excelReader;
+  ExcelReaderOptions options;
 
-  for (const auto &row : excelReader.read(xlsxPath)) {
-    if (row.empty())
-      continue;
-    std::cout << excelRow2Csv(row) << std::endl;
+  auto parser = parseSheetParserKind(program.get<std::string>("--parser"));
+  if (!parser.has_value()) {
+    std::cerr << "--parser: expected one of fast, expat" << std::endl;
+    return 1;
+  }
+  options.parser = parser.value();
+
+  auto inflateBackend =
+      parseInflateBackend(program.get<std::string>("--inflate"));
+  if (!inflateBackend.has_value()) {
+    std::cerr << "--inflate: expected one of zlib, libdeflate" << std::endl;
+    return 1;
+  }
+  if (!isInflateBackendAvailable(inflateBackend.value())) {
+    std::cerr << "--inflate: excel2csv was built without libdeflate support"
+              << std::endl;
+    return 1;
+  }
+  options.inflateBackend = inflateBackend.value();
+
+  int chunkSize = program.get<int>("--chunk-size");
+  if (chunkSize < 0) {
+    std::cerr << "--chunk-size: expected a non-negative number of bytes"
+              << std::endl;
+    return 1;
+  }
+  options.chunkSize = static_cast<std::size_t>(chunkSize);
+
+  options.pipelined = program.get<bool>("--pipelined");
+  options.rawNumbers = program.get<bool>("--raw-numbers");
+  options.numberFormats = program.get<bool>("--number-formats");
+
+  int stringsBudget = program.get<int>("--strings-budget");
+  if (stringsBudget < 0) {
+    std::cerr << "--strings-budget: expected a non-negative number of MiB"
+              << std::endl;
+    return 1;
+  }
+  options.sharedStringsBudget = static_cast<std::size_t>(stringsBudget) << 20;
+  options.lazySharedStrings = program.get<bool>("--lazy-strings");
+  options.concurrentSharedStrings = program.get<bool>("--concurrent-strings");
+#ifndef EXCEL2CSV_THREADS
+  if (options.pipelined) {
+    std::cerr << "--pipelined: excel2csv was built without thread support"
+              << std::endl;
+    return 1;
+  }
+  if (options.concurrentSharedStrings) {
+    std::cerr << "--concurrent-strings: excel2csv was built without thread "
+                 "support"
+              << std::endl;
+    return 1;
+  }
+#endif
+
+  int threads = program.get<int>("--threads");
+  if (threads < 1) {
+    std::cerr << "--threads: expected a positive number of threads"
+              << std::endl;
+    return 1;
+  }
+#ifndef EXCEL2CSV_THREADS
+  if (threads > 1) {
+    std::cerr << "--threads: excel2csv was built without thread support"
+              << std::endl;
+    return 1;
+  }
+#endif
+  options.threads = static_cast<std::size_t>(threads);
+
+  int skipRows = program.get<int>("--skip-rows");
+  if (skipRows < 0) {
+    std::cerr << "--skip-rows: expected a non-negative number of rows"
+              << std::endl;
+    return 1;
+  }
+  options.skipRows = static_cast<std::size_t>(skipRows);
+
+  if (auto maxRows = program.present<int>("--max-rows")) {
+    if (maxRows.value() < 0) {
+      std::cerr << "--max-rows: expected a non-negative number of rows"
+                << std::endl;
+      return 1;
+    }
+    options.maxRows = static_cast<std::size_t>(maxRows.value());
+  }
+
+  if (program.is_used("--columns") && program.is_used("--columns-by-header")) {
+    std::cerr << "--columns and --columns-by-header are mutually exclusive"
+              << std::endl;
+    return 1;
+  }
+  if (auto spec = program.present("--columns")) {
+    options.columns = ColumnSelection::parse(spec.value());
+    if (!options.columns.has_value()) {
+      std::cerr << "--columns: expected distinct columns or ranges, e.g. "
+                   "A,C,F:H"
+                << std::endl;
+      return 1;
+    }
+  }
+  if (auto names = program.present("--columns-by-header")) {
+    std::string_view rest = names.value();
+    while (true) {
+      std::size_t comma = rest.find(',');
+      std::string name(rest.substr(0, comma));
+      if (name.empty() ||
+          std::find(options.columnHeaders.begin(), options.columnHeaders.end(),
+                    name) != options.columnHeaders.end()) {
+        std::cerr << "--columns-by-header: expected distinct, non-empty names"
+                  << std::endl;
+        return 1;
+      }
+      options.columnHeaders.push_back(std::move(name));
+      if (comma == std::string_view::npos) {
+        break;
+      }
+      rest.remove_prefix(comma + 1);
+    }
+  }
+
+  ExcelReader excelReader(options);
+
+  try {
+    // Reused for every row
+    std::string csvLine;
+    for (auto row : excelReader.readCells(xlsxPath)) {
+      if (row.empty())
+        continue;
+      csvLine.clear();
+      excelRow2Csv(row, csvLine, &row.sharedStrings(), &row.styles());
+      std::cout << csvLine << std::endl;
+    }
+  } catch (const std::invalid_argument &err) {
+    std::cerr << err.what() << std::endl;
+    return 1;
   }
 
   return 0;
@@ -0,0 +1,43 @@
+#include "Arena.h"
+#include "doctest/doctest.h"
+#include <cstdint>
+#include <string>
+
+TEST_CASE("Arena") {
+  SUBCASE("aligns and copies") {
+    Arena arena(1024);
+    arena.store("x");
+    auto address = reinterpret_cast<std::uintptr_t>(arena.allocate(8, 8));
+    CHECK(address % 8 == 0);
+    CHECK(arena.store("text") == "text");
+    CHECK(arena.store("").empty());
+  }
+
+  SUBCASE("reuses its blocks after reset()") {
+    Arena arena(1024);
+    for (int round = 0; round < 3; ++round) {
+      for (int i = 0; i < 100; ++i) {
+        arena.store(std::string(30, 'a'));
+      }
+      arena.reset();
+    }
+    CHECK(arena.capacity() == 3 * 1024);
+  }
+
+  SUBCASE("frees oversized and adopted blocks on reset()") {
+    Arena arena(1024);
+    arena.store("small");
+    auto big = arena.store(std::string(5000, 'b'));
+    CHECK(big == std::string(5000, 'b'));
+
+    Arena other(1024);
+    auto adopted = other.store("adopted");
+    arena.adopt(std::move(other));
+    CHECK(adopted == "adopted");
+    CHECK(other.capacity() == 0);
+    CHECK(arena.capacity() == 1024 + 5000 + 1024);
+
+    arena.reset();
+    CHECK(arena.capacity() == 1024);
+  }
+}
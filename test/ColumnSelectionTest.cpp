@@ -0,0 +1,97 @@
+#include "ColumnSelection.h"
+#include "ExcelReader.h"
+#include "XlsxFixture.h"
+#include "doctest/doctest.h"
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using xlsx_fixture::readAll;
+
+TEST_CASE("parseColumnReference") {
+  CHECK(parseColumnReference("A") == 0u);
+  CHECK(parseColumnReference("Z") == 25u);
+  CHECK(parseColumnReference("AA") == 26u);
+  CHECK(parseColumnReference("ab3") == 27u);
+  CHECK(parseColumnReference("B12") == 1u);
+  CHECK(parseColumnReference("XFD1048576") == 16383u);
+  CHECK_FALSE(parseColumnReference("XFE").has_value());
+  CHECK_FALSE(parseColumnReference("12").has_value());
+  CHECK_FALSE(parseColumnReference("").has_value());
+}
+
+TEST_CASE("ColumnSelection") {
+  SUBCASE("parses columns and ranges in order") {
+    auto selection = ColumnSelection::parse("H,A,C:E").value();
+    CHECK(selection.columns() == std::vector<std::uint32_t>{7, 0, 2, 3, 4});
+    CHECK(selection.slotOf(7) == 0u);
+    CHECK(selection.slotOf(3) == 3u);
+    CHECK_FALSE(selection.slotOf(1).has_value());
+    CHECK_FALSE(selection.slotOf(100).has_value());
+  }
+
+  SUBCASE("rejects malformed lists") {
+    for (auto spec : {"", "A,", ",A", "F:C", "A,B:C,B", "A1", "A:B:C", "A-C"}) {
+      CHECK_MESSAGE(!ColumnSelection::parse(spec).has_value(), spec);
+    }
+  }
+}
+
+TEST_CASE("ExcelReader column projection") {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_columns.xlsx");
+  const std::string &path = workbook.path();
+  // C1 is missing, row 3 has no cell references and row 4 no cells
+  xlsx_fixture::writeXlsx(
+      path,
+      xlsx_fixture::worksheetXml(
+          "<row r=\"1\"><c r=\"A1\" t=\"s\"><v>0</v></c>"
+          "<c r=\"B1\" t=\"s\"><v>1</v></c><c r=\"D1\" t=\"s\"><v>2</v></c>"
+          "</row><row r=\"2\"><c r=\"A2\"><v>1</v></c>"
+          "<c r=\"C2\" t=\"inlineStr\"><is><t>x</t></is></c>"
+          "<c r=\"D2\"><v>3.5</v></c></row>"
+          "<row><c><v>7</v></c><c><v>8</v></c></row><row r=\"4\"/>"),
+      {"id", "name", "score"});
+
+  std::vector<std::vector<ExcelValue>> expected = {
+      {std::string("score"), std::string("id")},
+      {3.5, 1.0},
+      {std::string(), 7.0},
+      {std::string(), std::string()},
+  };
+
+  for (auto parser : {SheetParserKind::Fast, SheetParserKind::Expat}) {
+    CHECK(readAll(path, {.parser = parser,
+                         .columns = ColumnSelection::parse("D,A")}) ==
+          expected);
+    CHECK(readAll(path, {.parser = parser,
+                         .columnHeaders = {"score", "id"}}) == expected);
+    CHECK_THROWS_AS(readAll(path, {.parser = parser,
+                                   .columnHeaders = {"id", "missing"}}),
+                    std::invalid_argument);
+  }
+}
+
+// run with: zig build run-test -- --no-skip
+// --test-case="BENCHMARK-columns"
+TEST_CASE("BENCHMARK-columns" * doctest::skip()) {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_columns_bench.xlsx");
+  const std::string &path = workbook.path();
+  xlsx_fixture::writeXlsx(
+      path, xlsx_fixture::worksheetXml(xlsx_fixture::numericRows(5000, 200)));
+
+  for (auto parser : {SheetParserKind::Fast, SheetParserKind::Expat}) {
+    for (auto spec : {"A:GR", "A:J", "B,M,AZ,CX,GR"}) {
+      auto start = std::chrono::high_resolution_clock::now();
+      auto rows = readAll(path, {.parser = parser,
+                                 .columns = ColumnSelection::parse(spec)});
+      auto end = std::chrono::high_resolution_clock::now();
+      auto duration =
+          std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+      MESSAGE(parser == SheetParserKind::Fast ? "fast" : "expat",
+              " --columns=", spec, " read ", rows.size(), " rows in: ",
+              duration.count(), " micro-seconds");
+      CHECK(rows.size() == 5000);
+    }
+  }
+}
@@ -1,6 +1,14 @@
 #include "ExcelReader.h"
+#include "ExcelRow2Csv.h"
+#include "RowBatch.h"
 #include "Utils.h"
+#include "XlsxFixture.h"
 #include "doctest/doctest.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+using xlsx_fixture::readCsv;
 
 TEST_CASE("ExcelReader") {
   ExcelReader excelReader;
@@ -96,4 +104,335 @@ TEST_CASE("ExcelReader") {
   }
 
   CHECK(rowCount == 1001);
-}
\ No newline at end of file
+}
+
+TEST_CASE("ExcelReader reads stored (uncompressed) entries") {
+  ExcelReader excelReader;
+
+  int rowCount = 0;
+  for (const auto &row :
+       excelReader.read("./test/fixtures/sample_sheet_stored.xlsx")) {
+    if (rowCount == 1) {
+      CHECK(std::get<std::string>(row[0]) == "EMP0001");
+      CHECK(std::get<double>(row[7]) == 111653);
+    }
+    rowCount++;
+  }
+
+  CHECK(rowCount == 1001);
+}
+
+namespace {
+
+std::vector<std::vector<ExcelValue>> readSample(ExcelReaderOptions options) {
+  ExcelReader excelReader(options);
+  std::vector<std::vector<ExcelValue>> rows;
+  for (const auto &row :
+       excelReader.read("./test/fixtures/sample_sheet.xlsx")) {
+    rows.push_back(row);
+  }
+  return rows;
+}
+
+} // namespace
+
+TEST_CASE("ExcelReader row range") {
+  auto all = readSample({});
+  REQUIRE(all.size() == 1001);
+
+  for (auto parser : {SheetParserKind::Fast, SheetParserKind::Expat}) {
+    auto range = readSample({.parser = parser, .skipRows = 10, .maxRows = 5});
+    CHECK(range == decltype(all)(all.begin() + 10, all.begin() + 15));
+
+    auto tail = readSample({.parser = parser, .skipRows = 995});
+    CHECK(tail == decltype(all)(all.begin() + 995, all.end()));
+
+    CHECK(readSample({.parser = parser, .maxRows = 0}).empty());
+    CHECK(readSample({.parser = parser, .skipRows = 2000}).empty());
+    CHECK(readSample({.parser = parser, .maxRows = 5000}) == all);
+
+    // The skipped header row still picks the columns
+    auto emails = readSample({.parser = parser,
+                              .columnHeaders = {"email"},
+                              .skipRows = 1,
+                              .maxRows = 2});
+    REQUIRE(emails.size() == 2);
+    CHECK(emails[1] == std::vector<ExcelValue>{all[2][3]});
+  }
+}
+
+TEST_CASE("ExcelReader shared strings") {
+  auto all = readSample({});
+
+  for (auto parser : {SheetParserKind::Fast, SheetParserKind::Expat}) {
+    ExcelReader excelReader({.parser = parser});
+    std::size_t rowCount = 0;
+    std::size_t sharedCount = 0;
+    for (auto row :
+         excelReader.readCells("./test/fixtures/sample_sheet.xlsx")) {
+      for (std::size_t i = 0; i < row.size(); ++i) {
+        if (row[i].kind() == ExcelCell::Kind::SharedString) {
+          sharedCount++;
+        }
+        CHECK(toExcelValue(row[i], row.sharedStrings()) ==
+              all[rowCount][i]);
+      }
+      CHECK(excelRow2Csv(row, &row.sharedStrings()) ==
+            excelRow2Csv(all[rowCount]));
+      rowCount++;
+    }
+    CHECK(rowCount == all.size());
+    // Left as indices up to the writer
+    CHECK(sharedCount > 0);
+  }
+}
+
+TEST_CASE("ExcelReader keeps overlapping reads apart") {
+  std::string sample = "./test/fixtures/sample_sheet.xlsx";
+  xlsx_fixture::TempWorkbook workbook("excel2csv_overlap.xlsx");
+  const std::string &path = workbook.path();
+  xlsx_fixture::writeXlsx(
+      path, xlsx_fixture::worksheetXml("<row><c t=\"s\"><v>1</v></c></row>"),
+      {"first", "second"});
+
+  ExcelReader excelReader;
+  std::vector<std::string> expected;
+  for (auto row : excelReader.readCells(sample)) {
+    expected.push_back(excelRow2Csv(row, &row.sharedStrings()));
+  }
+
+  // The second workbook's table mustn't replace the first one's
+  auto sampleRows = excelReader.readCells(sample);
+  auto sampleRow = sampleRows.begin();
+  REQUIRE(sampleRow != sampleRows.end());
+  for (auto row : excelReader.readCells(path)) {
+    CHECK(excelRow2Csv(row, &row.sharedStrings()) == "second");
+  }
+  std::vector<std::string> lines;
+  for (; sampleRow != sampleRows.end(); ++sampleRow) {
+    lines.push_back(excelRow2Csv(*sampleRow, &sampleRow->sharedStrings()));
+  }
+  CHECK(lines == expected);
+}
+
+TEST_CASE("ExcelReader raw numbers") {
+  std::string sample = "./test/fixtures/sample_sheet.xlsx";
+  auto all = readSample({});
+
+  for (auto parser : {SheetParserKind::Fast, SheetParserKind::Expat}) {
+    // Typed consumers still get doubles
+    CHECK(readSample({.parser = parser, .rawNumbers = true}) == all);
+
+    // Written as stored in the sheet
+    auto csv = readCsv(sample, {.parser = parser, .rawNumbers = true});
+    REQUIRE(csv.size() == all.size());
+    CHECK(csv[1] == "EMP0001,Christopher,Sanchez,christopher.sanchez@company."
+                    "com,Operations,Junior Developer,2019-07-28,111653,"
+                    "Chicago,4.6,23,True");
+  }
+
+  xlsx_fixture::TempWorkbook workbook("excel2csv_raw_numbers.xlsx");
+  const std::string &path = workbook.path();
+  xlsx_fixture::writeXlsx(
+      path, xlsx_fixture::worksheetXml(
+                "<row r=\"1\"><c r=\"A1\"><v>0.30000000000000004</v></c>"
+                "<c r=\"B1\"><v>1.5E-7</v></c><c r=\"C1\"><v>12</v></c>"
+                "<c r=\"D1\" t=\"str\"><v>n/a</v></c></row>"));
+  for (auto parser : {SheetParserKind::Fast, SheetParserKind::Expat}) {
+    CHECK(readCsv(path, {.parser = parser, .rawNumbers = true}) ==
+          std::vector<std::string>{"0.30000000000000004,1.5E-7,12,n/a"});
+  }
+}
+
+// run with: zig build run-test -- --no-skip
+// --test-case="BENCHMARK-rawNumbers"
+TEST_CASE("BENCHMARK-rawNumbers" * doctest::skip()) {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_raw_numbers.xlsx");
+  const std::string &path = workbook.path();
+  std::string rows;
+  for (int row = 1; row <= 100000; ++row) {
+    rows += "<row r=\"" + std::to_string(row) + "\">";
+    for (int column = 0; column < 10; ++column) {
+      rows += "<c><v>" + std::to_string(row * 0.37 + column) + "</v></c>";
+    }
+    rows += "</row>";
+  }
+  xlsx_fixture::writeXlsx(path, xlsx_fixture::worksheetXml(rows));
+
+  for (bool rawNumbers : {false, true}) {
+    auto start = std::chrono::high_resolution_clock::now();
+    ExcelReader excelReader({.rawNumbers = rawNumbers});
+    std::string csvLine;
+    std::size_t bytes = 0;
+    for (auto row : excelReader.readCells(path)) {
+      csvLine.clear();
+      excelRow2Csv(row, csvLine, &row.sharedStrings());
+      bytes += csvLine.size();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    MESSAGE(rawNumbers ? "raw numbers" : "parsed numbers", " wrote ", bytes,
+            " bytes in: ", duration.count(), " micro-seconds");
+  }
+}
+
+// run with: zig build run-test -- --no-skip
+// --test-case="BENCHMARK-maxRows"
+TEST_CASE("BENCHMARK-maxRows" * doctest::skip()) {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_max_rows.xlsx");
+  const std::string &path = workbook.path();
+  xlsx_fixture::writeXlsx(
+      path, xlsx_fixture::worksheetXml(xlsx_fixture::numericRows(200000, 10)));
+
+  for (std::optional<std::size_t> maxRows :
+       {std::optional<std::size_t>(100), std::optional<std::size_t>()}) {
+    auto start = std::chrono::high_resolution_clock::now();
+    ExcelReader excelReader({.maxRows = maxRows});
+    std::size_t rowCount = 0;
+    for ([[maybe_unused]] const auto &row : excelReader.read(path)) {
+      rowCount++;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    MESSAGE("read ", rowCount, " rows in: ", duration.count(),
+            " micro-seconds");
+    CHECK(rowCount == maxRows.value_or(200000));
+  }
+}
+
+// run with: zig build run-test -- --no-skip
+// --test-case="BENCHMARK-trailer"
+TEST_CASE("BENCHMARK-trailer" * doctest::skip()) {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_trailer.xlsx");
+  const std::string &path = workbook.path();
+  std::string rows = xlsx_fixture::numericRows(20000, 10);
+
+  for (auto trailer : {std::string(), xlsx_fixture::heavyTrailer(200000)}) {
+    xlsx_fixture::writeXlsx(path, xlsx_fixture::worksheetXml(rows, trailer));
+
+    // What draining the entry to its end used to cost on top of parsing
+    auto archive = ZipUtils::open(path).value();
+    auto start = std::chrono::high_resolution_clock::now();
+    std::size_t total = 0;
+    for (const auto &chunk :
+         ZipUtils::readFileChunked(archive, "xl/worksheets/sheet1.xml")) {
+      total += chunk.size();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    MESSAGE("inflating all ", total, " bytes takes: ",
+            std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+                .count(),
+            " micro-seconds");
+
+    for (auto parser : {SheetParserKind::Fast, SheetParserKind::Expat}) {
+      auto start = std::chrono::high_resolution_clock::now();
+      ExcelReader excelReader({.parser = parser});
+      std::size_t rowCount = 0;
+      for ([[maybe_unused]] const auto &row : excelReader.read(path)) {
+        rowCount++;
+      }
+      auto end = std::chrono::high_resolution_clock::now();
+      auto duration =
+          std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+      MESSAGE(parser == SheetParserKind::Fast ? "fast" : "expat", " with ",
+              trailer.size(), " trailer bytes read ", rowCount, " rows in: ",
+              duration.count(), " micro-seconds");
+      CHECK(rowCount == 20000);
+    }
+  }
+}
+
+#ifdef EXCEL2CSV_THREADS
+TEST_CASE("ExcelReader pipelined") {
+  ExcelReader excelReader({.pipelined = true});
+
+  int rowCount = 0;
+  for (const auto &row :
+       excelReader.read("./test/fixtures/sample_sheet.xlsx")) {
+    if (rowCount == 1000) {
+      CHECK(std::holds_alternative<std::string>(row[0]));
+    }
+    rowCount++;
+  }
+
+  CHECK(rowCount == 1001);
+}
+
+TEST_CASE("ExcelReader concurrent shared strings") {
+  std::string sample = "./test/fixtures/sample_sheet.xlsx";
+  std::vector<std::string> expected;
+  ExcelReader sequential;
+  for (auto cells : sequential.readCells(sample)) {
+    expected.push_back(excelRow2Csv(cells, &cells.sharedStrings()));
+  }
+
+  for (auto parser : {SheetParserKind::Fast, SheetParserKind::Expat}) {
+    for (std::size_t threads : {1, 3}) {
+      ExcelReader excelReader({.parser = parser,
+                               .threads = threads,
+                               .concurrentSharedStrings = true});
+      std::vector<std::string> lines;
+      for (auto cells : excelReader.readCells(sample)) {
+        lines.push_back(excelRow2Csv(cells, &cells.sharedStrings()));
+      }
+      CHECK(lines == expected);
+    }
+  }
+
+  // Stopping early leaves the strings collecting, reading again restarts
+  ExcelReader excelReader({.concurrentSharedStrings = true});
+  for (int round = 0; round < 2; ++round) {
+    for (auto cells : excelReader.readCells(sample)) {
+      CHECK(excelRow2Csv(cells, &cells.sharedStrings()) == expected[0]);
+      break;
+    }
+  }
+}
+
+// run with: zig build run-test -- --no-skip
+// --test-case="BENCHMARK-concurrentStrings"
+TEST_CASE("BENCHMARK-concurrentStrings" * doctest::skip()) {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_concurrent.xlsx");
+  const std::string &path = workbook.path();
+  // Every cell a string of its own, in the order Excel writes them
+  std::vector<std::string> strings;
+  std::string rows;
+  for (std::size_t row = 1; row <= 100000; ++row) {
+    rows += "<row r=\"" + std::to_string(row) + "\">";
+    for (int column = 0; column < 5; ++column) {
+      rows += "<c r=\"" + xlsx_fixture::columnName(column) +
+              std::to_string(row) + "\" t=\"s\"><v>" +
+              std::to_string(strings.size()) + "</v></c>";
+      strings.push_back("text " + std::to_string(strings.size() * 7919));
+    }
+    rows += "</row>";
+  }
+  xlsx_fixture::writeXlsx(path, xlsx_fixture::worksheetXml(rows), strings);
+
+  for (bool concurrent : {false, true}) {
+    auto start = std::chrono::high_resolution_clock::now();
+    ExcelReader excelReader({.concurrentSharedStrings = concurrent});
+    std::string line;
+    std::size_t length = 0;
+    std::chrono::microseconds firstRow{};
+    for (auto cells : excelReader.readCells(path)) {
+      if (length == 0) {
+        firstRow = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - start);
+      }
+      line.clear();
+      excelRow2Csv(cells, line, &cells.sharedStrings());
+      length += line.size() + 1;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    MESSAGE((concurrent ? "concurrent" : "sequential"),
+            " shared strings, first row after ", firstRow.count(),
+            " micro-seconds, wrote ", length, " bytes in: ", duration.count(),
+            " micro-seconds");
+  }
+}
+#endif
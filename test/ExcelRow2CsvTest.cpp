@@ -1,6 +1,13 @@
+#include "CsvField.h"
+#include "ExcelCell.h"
 #include "ExcelRow2Csv.h"
 #include "ExcelValue.h"
+#include "StringTableReader.h"
+#include "Utils.h"
+#include "XlsxFixture.h"
 #include "doctest/doctest.h"
+#include <chrono>
+#include <string>
 #include <vector>
 
 TEST_CASE("excelRow2Csv") {
@@ -11,4 +18,110 @@ TEST_CASE("excelRow2Csv") {
     auto csvLine = excelRow2Csv(line);
     CHECK(csvLine == "Hello World,3.14,true,,\"I heckin love \"\"csv\"\"\"");
   }
-}
\ No newline at end of file
+
+  SUBCASE("Compact cells") {
+    std::vector<ExcelCell> line = {
+        ExcelCell::string("a,b"), ExcelCell::number(2), ExcelCell(),
+        ExcelCell::boolean(false), ExcelCell::string("line\nbreak")};
+    CHECK(excelRow2Csv(line) == "\"a,b\",2,,false,\"line\nbreak\"");
+  }
+
+  SUBCASE("Number text is written as is") {
+    std::vector<ExcelCell> line = {ExcelCell::numberText("0.30000000000000004"),
+                                   ExcelCell::numberText("1E-3")};
+    CHECK(excelRow2Csv(line) == "0.30000000000000004,1E-3");
+  }
+}
+
+TEST_CASE("CsvField") {
+  CHECK(csvQuotingOf("") == CsvQuoting::None);
+  CHECK(csvQuotingOf("plain text") == CsvQuoting::None);
+  CHECK(csvQuotingOf("a,b") == CsvQuoting::Quoted);
+  CHECK(csvQuotingOf("carriage\rreturn") == CsvQuoting::Quoted);
+  CHECK(csvQuotingOf("say \"hi\", then\n") == CsvQuoting::Escaped);
+
+  std::string result;
+  appendCsvField(result, "a,b", CsvQuoting::Quoted);
+  result += ',';
+  appendCsvField(result, "\"\"x\"");
+  result += ',';
+  appendCsvField(result, "plain");
+  CHECK(result == "\"a,b\",\"\"\"\"\"x\"\"\",plain");
+}
+
+TEST_CASE("excelRow2Csv shared strings") {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_quoting.xlsx");
+  const std::string &path = workbook.path();
+  std::vector<std::string> strings = {"plain", "a,b", "say \"hi\"",
+                                      "line\nbreak"};
+  xlsx_fixture::writeXlsx(path, xlsx_fixture::worksheetXml(""), strings);
+  auto file = ZipUtils::open(path).value();
+
+  // In memory, spilled and lazy tables all know how to write their strings
+  StringTableReader inMemory;
+  StringTableReader spilling(20);
+  StringTableReader lazy(0, true);
+  for (auto *sharedStrings : {&inMemory, &spilling, &lazy}) {
+    sharedStrings->collect(file);
+    REQUIRE(sharedStrings->size() == strings.size());
+    std::vector<ExcelCell> line;
+    for (std::uint32_t i = 0; i < strings.size(); ++i) {
+      CHECK(sharedStrings->csvQuoting(i) == csvQuotingOf(strings[i]));
+      line.push_back(ExcelCell::sharedString(i));
+    }
+    CHECK(excelRow2Csv(line, sharedStrings) ==
+          "plain,\"a,b\",\"say \"\"hi\"\"\",\"line\nbreak\"");
+  }
+  CHECK(spilling.spilledCount() > 0);
+  CHECK(spilling.inMemoryCount() > 0);
+  CHECK(lazy.isLazy());
+}
+
+// run with: zig build run-test -- --no-skip
+// --test-case="BENCHMARK-sharedStringCsv"
+TEST_CASE("BENCHMARK-sharedStringCsv" * doctest::skip()) {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_quoting.xlsx");
+  const std::string &path = workbook.path();
+  // Few distinct strings written over and over, as category columns are
+  std::vector<std::string> strings;
+  for (std::size_t i = 0; i < 1000; ++i) {
+    strings.push_back("a category name, number " + std::to_string(i));
+  }
+  xlsx_fixture::writeXlsx(path, xlsx_fixture::worksheetXml(""), strings);
+  auto file = ZipUtils::open(path).value();
+  StringTableReader sharedStrings;
+  sharedStrings.collect(file);
+
+  std::vector<ExcelCell> line;
+  for (std::uint32_t column = 0; column < 20; ++column) {
+    line.push_back(ExcelCell::sharedString(column * 37 % strings.size()));
+  }
+  std::string result;
+  std::size_t length = 0;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (std::size_t row = 0; row < 500000; ++row) {
+    result.clear();
+    // Scanning every string as it's written
+    for (const auto &cell : line) {
+      appendCsvField(result,
+                     sharedStrings.getStringEntry(cell.sharedStringIndex()));
+      result += ',';
+    }
+    length += result.size();
+  }
+  auto middle = std::chrono::high_resolution_clock::now();
+  for (std::size_t row = 0; row < 500000; ++row) {
+    result.clear();
+    excelRow2Csv(line, result, &sharedStrings);
+    length += result.size();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+
+  auto scanning =
+      std::chrono::duration_cast<std::chrono::microseconds>(middle - start);
+  auto precomputed =
+      std::chrono::duration_cast<std::chrono::microseconds>(end - middle);
+  MESSAGE("scanning: ", scanning.count(), " micro-seconds, precomputed: ",
+          precomputed.count(), " micro-seconds, ", length, " bytes");
+}
@@ -0,0 +1,107 @@
+#include "LazyStringTable.h"
+#include "StringTableReader.h"
+#include "Utils.h"
+#include "XlsxFixture.h"
+#include "doctest/doctest.h"
+#include <string>
+#include <vector>
+
+namespace {
+
+void writeSharedStrings(const std::string &path, const std::string &xml) {
+  xlsx_fixture::writeZip(path, {{"xl/sharedStrings.xml", xml}});
+}
+
+} // namespace
+
+TEST_CASE("LazyStringTable decodes items on demand") {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_lazy.xlsx");
+  writeSharedStrings(
+      workbook.path(),
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<sst><!-- <si><t>comment</t></si> -->\n"
+      "<si><t>a &amp; b &#x263A;</t></si>\n"
+      "<si/>"
+      "<si><r><t>rich</t></r><r><rPr><b/></rPr>"
+      "<t xml:space=\"preserve\"> text</t></r>"
+      "<rPh sb=\"0\" eb=\"1\"><t>ri</t></rPh></si>"
+      "<si><t><![CDATA[<si>x]]></t></si>\n"
+      "</sst>");
+  auto file = ZipUtils::open(workbook.path()).value();
+  std::vector<std::byte> buffer;
+
+  StringTableReader eager;
+  eager.collect(file);
+  LazyStringTable lazy(1024);
+  REQUIRE(lazy.collect(file, buffer));
+  CHECK(lazy.cachedCount() == 0);
+
+  REQUIRE(lazy.size() == 4);
+  REQUIRE(eager.size() == 4);
+  CHECK(lazy.get(0) == "a & b \xE2\x98\xBA");
+  CHECK(lazy.get(1).empty());
+  CHECK(lazy.get(3) == "<si>x");
+  for (std::size_t i = 0; i < lazy.size(); ++i) {
+    CHECK(lazy.get(i) == eager.getStringEntry(i));
+  }
+  CHECK(lazy.cachedCount() == 4);
+}
+
+TEST_CASE("LazyStringTable keeps its cache within budget") {
+  std::vector<std::string> strings;
+  for (int i = 0; i < 100; ++i) {
+    strings.push_back("string " + std::to_string(i));
+  }
+  xlsx_fixture::TempWorkbook workbook("excel2csv_lazy.xlsx");
+  writeSharedStrings(workbook.path(),
+                     xlsx_fixture::sharedStringsXml(strings));
+  auto file = ZipUtils::open(workbook.path()).value();
+  std::vector<std::byte> buffer;
+
+  // Room for about three strings, the one just decoded always stays
+  for (std::size_t budget : {std::size_t(0), std::size_t(250)}) {
+    LazyStringTable lazy(budget);
+    REQUIRE(lazy.collect(file, buffer));
+    for (int round = 0; round < 2; ++round) {
+      for (std::size_t i = 0; i < strings.size(); ++i) {
+        CHECK(lazy.get(i) == strings[i]);
+      }
+    }
+    CHECK(lazy.cachedCount() == (budget == 0 ? 1 : 3));
+  }
+}
+
+TEST_CASE("LazyStringTable leaves documents with a DTD to expat") {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_lazy.xlsx");
+  writeSharedStrings(
+      workbook.path(),
+      "<?xml version=\"1.0\"?>"
+      "<!DOCTYPE sst [<!ENTITY company \"Acme\">]>"
+      "<sst><si><t>&company;</t></si></sst>");
+  auto file = ZipUtils::open(workbook.path()).value();
+  std::vector<std::byte> buffer;
+
+  LazyStringTable lazy(1024);
+  CHECK_FALSE(lazy.collect(file, buffer));
+
+  StringTableReader reader(StringTableReader::kDefaultMemoryBudget, true);
+  reader.collect(file);
+  CHECK_FALSE(reader.isLazy());
+  REQUIRE(reader.size() == 1);
+  CHECK(reader.getStringEntry(0) == "Acme");
+}
+
+TEST_CASE("LazyStringTable leaves other encodings to expat") {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_lazy.xlsx");
+  writeSharedStrings(
+      workbook.path(),
+      "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>"
+      "<sst><si><t>caf\xE9</t></si></sst>");
+  auto file = ZipUtils::open(workbook.path()).value();
+
+  StringTableReader reader(StringTableReader::kDefaultMemoryBudget, true);
+  reader.collect(file);
+  CHECK_FALSE(reader.isLazy());
+  REQUIRE(reader.size() == 1);
+  CHECK(reader.getStringEntry(0) == "caf\xC3\xA9");
+}
@@ -0,0 +1,125 @@
+#include "NumberCodec.h"
+#include "Utils.h"
+#include "doctest/doctest.h"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+TEST_CASE("parseNumber") {
+  CHECK(parseNumber("42") == 42.0);
+  CHECK(parseNumber("-0.5") == -0.5);
+  CHECK(parseNumber("1.5E-7") == 1.5e-7);
+  CHECK(parseNumber("4.5999999999999996") == 4.6);
+
+  CHECK_FALSE(parseNumber("").has_value());
+  CHECK_FALSE(parseNumber("n/a").has_value());
+  CHECK_FALSE(parseNumber("12abc").has_value());
+  CHECK_FALSE(parseNumber("1e999").has_value());
+  CHECK_FALSE(parseNumber("+5").has_value());
+}
+
+TEST_CASE("isNumberText") {
+  for (auto text : {"0", "-12", "0.5", ".5", "5.", "1.2E-3", "7e+10"}) {
+    CHECK(isNumberText(text));
+    CHECK(parseNumber(text).has_value());
+  }
+  for (auto text : {"", "-", ".", "e5", "1e", "1.2.3", " 1", "1 ", "0x10",
+                    "inf", "12abc", "+5"}) {
+    CHECK_FALSE(isNumberText(text));
+  }
+}
+
+TEST_CASE("formatNumber") {
+  auto format = [](double number) {
+    std::string text;
+    appendNumber(text, number);
+    return text;
+  };
+
+  CHECK(format(0) == "0");
+  CHECK(format(-0.0) == "0");
+  CHECK(format(111653) == "111653");
+  CHECK(format(1000000) == "1000000");
+  CHECK(format(4.6) == "4.6");
+  CHECK(format(-2.8) == "-2.8");
+  CHECK(format(0.1 + 0.2) == "0.30000000000000004");
+  CHECK(format(1.5e-7) == "0.00000015");
+  CHECK(format(1e-8) == "1e-08");
+  CHECK(format(1e21) == "1e+21");
+  CHECK(format(std::numeric_limits<double>::infinity()) == "inf");
+  CHECK(format(-std::numeric_limits<double>::max()) ==
+        "-1.7976931348623157e+308");
+  // The longest plain decimal still fits
+  auto longest = format(-1.2345678901234567e-7);
+  CHECK(longest.size() <= kMaxNumberLength);
+  CHECK(parseNumber(longest) == -1.2345678901234567e-7);
+
+  SUBCASE("round-trips") {
+    std::mt19937_64 random(7);
+    for (int i = 0; i < 10000; ++i) {
+      double number;
+      std::uint64_t bits = random();
+      std::memcpy(&number, &bits, sizeof(number));
+      if (std::isfinite(number)) {
+        CHECK(parseNumber(format(number)) == number);
+      }
+    }
+  }
+}
+
+// run with: zig build run-test -Doptimize=ReleaseSmall -- --no-skip
+// --test-case="BENCHMARK-numberCodec"
+TEST_CASE("BENCHMARK-numberCodec" * doctest::skip()) {
+  std::vector<std::string> texts;
+  std::vector<double> numbers;
+  for (int i = 0; i < 200000; ++i) {
+    numbers.push_back(i * 0.37 + i % 10);
+    texts.push_back(std::to_string(numbers.back()));
+  }
+
+  auto time = [](const char *name, auto &&run) {
+    auto start = std::chrono::high_resolution_clock::now();
+    std::size_t result = run();
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    MESSAGE(name, " ran in: ", duration.count(), " micro-seconds (", result,
+            ")");
+  };
+
+  time("std::stod", [&] {
+    double sum = 0;
+    for (const auto &text : texts) {
+      sum += std::stod(text);
+    }
+    return static_cast<std::size_t>(sum);
+  });
+  time("parseNumber", [&] {
+    double sum = 0;
+    for (const auto &text : texts) {
+      sum += parseNumber(text).value();
+    }
+    return static_cast<std::size_t>(sum);
+  });
+
+  time("doubleToString", [&] {
+    std::size_t length = 0;
+    for (double number : numbers) {
+      length += doubleToString(number).size();
+    }
+    return length;
+  });
+  time("formatNumber", [&] {
+    std::size_t length = 0;
+    char buffer[kMaxNumberLength];
+    for (double number : numbers) {
+      length += static_cast<std::size_t>(formatNumber(number, buffer) - buffer);
+    }
+    return length;
+  });
+}
@@ -0,0 +1,111 @@
+#include "NumberCodec.h"
+#include "NumberFormat.h"
+#include "doctest/doctest.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string write(NumberFormat format, double number) {
+  char buffer[kMaxNumberLength];
+  return std::string(buffer, format.write(number, buffer));
+}
+
+} // namespace
+
+TEST_CASE("NumberFormat") {
+  using Kind = NumberFormat::Kind;
+
+  SUBCASE("compiles format codes") {
+    CHECK(NumberFormat::compile("General") == Kind::General);
+    CHECK(NumberFormat::compile("@") == Kind::General);
+    CHECK(NumberFormat::compile("yyyy-mm-dd") == Kind::Date);
+    CHECK(NumberFormat::compile("d-mmm-yy") == Kind::Date);
+    CHECK(NumberFormat::compile("mmm") == Kind::Date);
+    CHECK(NumberFormat::compile("[$-409]dddd, mmmm dd, yyyy") == Kind::Date);
+    CHECK(NumberFormat::compile("h:mm AM/PM") == Kind::Time);
+    CHECK(NumberFormat::compile("mm:ss") == Kind::Time);
+    CHECK(NumberFormat::compile("m/d/yy h:mm") == Kind::DateTime);
+    CHECK(NumberFormat::compile("[h]:mm:ss") == Kind::Duration);
+    CHECK(NumberFormat::compile("[mm]:ss") == Kind::Duration);
+    CHECK(NumberFormat::compile("[SS].00") == Kind::Duration);
+    // Colors starting with h, m or s aren't elapsed time
+    CHECK(NumberFormat::compile("[Magenta]0.00") ==
+          NumberFormat(Kind::Fixed, 2));
+    CHECK(NumberFormat::compile("[Red]#,##0") == NumberFormat(Kind::Fixed, 0));
+    CHECK(NumberFormat::compile("[mh]:ss") == Kind::Time);
+    CHECK(NumberFormat::compile("0.0%") == NumberFormat(Kind::Percent, 1));
+    CHECK(NumberFormat::compile("#,##0.000") == NumberFormat(Kind::Fixed, 3));
+    CHECK(NumberFormat::compile("0.00;[Red]-0.00") ==
+          NumberFormat(Kind::Fixed, 2));
+    CHECK(NumberFormat::compile("\"$\"#,##0.00") == Kind::General);
+    CHECK(NumberFormat::compile("0.00E+00") == Kind::General);
+    CHECK(NumberFormat::compile("# ?/?") == Kind::General);
+  }
+
+  SUBCASE("knows the built-in formats") {
+    CHECK(NumberFormat::builtIn(0) == Kind::General);
+    CHECK(NumberFormat::builtIn(2) == NumberFormat(Kind::Fixed, 2));
+    CHECK(NumberFormat::builtIn(10) == NumberFormat(Kind::Percent, 2));
+    CHECK(NumberFormat::builtIn(14) == Kind::Date);
+    CHECK(NumberFormat::builtIn(21) == Kind::Time);
+    CHECK(NumberFormat::builtIn(22) == Kind::DateTime);
+    CHECK(NumberFormat::builtIn(46) == Kind::Duration);
+  }
+
+  SUBCASE("writes dates and times") {
+    CHECK(write(Kind::Date, 1) == "1900-01-01");
+    CHECK(write(Kind::Date, 59) == "1900-02-28");
+    CHECK(write(Kind::Date, 61) == "1900-03-01");
+    CHECK(write(Kind::Date, 25569) == "1970-01-01");
+    CHECK(write(Kind::Date, 45362.75) == "2024-03-11");
+    CHECK(write(Kind::Date, 2958465) == "9999-12-31");
+    CHECK(write(Kind::Time, 0.5) == "12:00:00");
+    CHECK(write(Kind::Time, 45362.545243) == "13:05:09");
+    CHECK(write(Kind::DateTime, 45362.545243) == "2024-03-11T13:05:09");
+    // Rounds to the next day
+    CHECK(write(Kind::DateTime, 45362.999999999) == "2024-03-12T00:00:00");
+    CHECK(write(Kind::Duration, 1.5) == "36:00:00");
+
+    // Excel can't show these as dates either
+    CHECK(write(Kind::Date, -1) == "-1");
+    CHECK(write(Kind::Date, 2958466) == "2958466");
+  }
+
+  SUBCASE("writes percentages and fixed decimals") {
+    CHECK(write({Kind::Percent, 1}, 0.256) == "25.6%");
+    CHECK(write({Kind::Percent, 0}, 1) == "100%");
+    CHECK(write({Kind::Fixed, 2}, 3.14159) == "3.14");
+    CHECK(write({Kind::Fixed, 0}, 111653.4) == "111653");
+    CHECK(write({Kind::Fixed, 2}, -0.5) == "-0.50");
+    CHECK(write({Kind::Fixed, 2}, 1e300) == "1e+300");
+    CHECK(write(Kind::General, 4.6) == "4.6");
+  }
+}
+
+// run with: zig build run-test -Doptimize=ReleaseSmall -- --no-skip
+// --test-case="BENCHMARK-numberFormat"
+TEST_CASE("BENCHMARK-numberFormat" * doctest::skip()) {
+  std::vector<double> serials;
+  for (int i = 0; i < 200000; ++i) {
+    serials.push_back(40000 + i * 0.137);
+  }
+
+  for (auto format :
+       {NumberFormat(), NumberFormat(NumberFormat::Kind::Date),
+        NumberFormat(NumberFormat::Kind::DateTime),
+        NumberFormat(NumberFormat::Kind::Fixed, 2)}) {
+    auto start = std::chrono::high_resolution_clock::now();
+    std::size_t length = 0;
+    char buffer[kMaxNumberLength];
+    for (double serial : serials) {
+      length += static_cast<std::size_t>(format.write(serial, buffer) - buffer);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    MESSAGE("format kind ", static_cast<int>(format.kind()), " wrote ", length,
+            " bytes in: ", duration.count(), " micro-seconds");
+  }
+}
@@ -0,0 +1,136 @@
+#ifdef EXCEL2CSV_THREADS
+
+#include "ExcelReader.h"
+#include "ParallelSheetParser.h"
+#include "StringTableReader.h"
+#include "XlsxFixture.h"
+#include "doctest/doctest.h"
+#include <algorithm>
+#include <chrono>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using xlsx_fixture::readAll;
+
+namespace {
+
+struct ParallelResult {
+  bool succeeded;
+  std::vector<std::vector<ExcelValue>> rows;
+};
+
+// Feeds `xml` to a ParallelSheetParser in chunks of `chunkSize` bytes
+ParallelResult parseParallel(std::string_view xml, SheetParserKind kind,
+                             std::size_t segmentSize, std::size_t chunkSize) {
+  StringTableReader stringTableReader;
+  ParallelSheetParser parser(stringTableReader, {}, kind, 4, segmentSize);
+  ParallelResult result{true, {}};
+  for (std::size_t offset = 0; offset < xml.size() && !parser.isDone();
+       offset += chunkSize) {
+    auto chunk = xml.substr(offset, chunkSize);
+    result.succeeded =
+        parser.feed(std::as_bytes(std::span(chunk.data(), chunk.size())));
+    for (auto &row : parser.extractCompletedRows().toValues()) {
+      result.rows.push_back(std::move(row));
+    }
+    if (!result.succeeded) {
+      return result;
+    }
+  }
+  result.succeeded = parser.finish();
+  for (auto &row : parser.extractCompletedRows().toValues()) {
+    result.rows.push_back(std::move(row));
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("ParallelSheetParser") {
+  std::string xml =
+      xlsx_fixture::worksheetXml(xlsx_fixture::numericRows(300, 7));
+  std::vector<std::vector<ExcelValue>> expected(
+      300, {0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0});
+
+  for (auto kind : {SheetParserKind::Fast, SheetParserKind::Expat}) {
+    SUBCASE("matches the sequential parsers in any segment size") {
+      for (std::size_t segmentSize : {1, 256, 5000, 1 << 20}) {
+        for (std::size_t chunkSize : {7, 1000, 1 << 20}) {
+          auto result = parseParallel(xml, kind, segmentSize, chunkSize);
+          CHECK(result.succeeded);
+          CHECK(result.rows == expected);
+        }
+      }
+    }
+
+    SUBCASE("fails when a cut lands inside other markup") {
+      std::string commented = xlsx_fixture::worksheetXml(
+          "<row r=\"1\"><c><v>1</v></c></row>"
+          "<!-- <row r=\"2\"><c><v>2</v></c></row> -->"
+          "<row r=\"3\"><c><v>3</v></c></row>");
+      CHECK_FALSE(parseParallel(commented, kind, 1, 1 << 20).succeeded);
+    }
+
+    SUBCASE("handles empty and truncated sheets") {
+      auto empty = parseParallel(
+          "<worksheet><sheetData/></worksheet>", kind, 256, 1 << 20);
+      CHECK(empty.succeeded);
+      CHECK(empty.rows.empty());
+
+      CHECK_FALSE(
+          parseParallel(xml.substr(0, xml.size() / 2), kind, 256, 1000)
+              .succeeded);
+    }
+  }
+}
+
+TEST_CASE("ExcelReader threads") {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_threads.xlsx");
+  const std::string &path = workbook.path();
+  xlsx_fixture::writeXlsx(
+      path, xlsx_fixture::worksheetXml(xlsx_fixture::numericRows(2000, 5)));
+  auto all = readAll(path, {});
+  REQUIRE(all.size() == 2000);
+
+  for (auto parser : {SheetParserKind::Fast, SheetParserKind::Expat}) {
+    CHECK(readAll(path, {.parser = parser, .threads = 4}) == all);
+
+    auto range = readAll(
+        path, {.parser = parser, .skipRows = 10, .maxRows = 5, .threads = 4});
+    CHECK(range == decltype(all)(all.begin() + 10, all.begin() + 15));
+
+    auto columns =
+        readAll(path, {.parser = parser,
+                       .columns = ColumnSelection::parse("E,B"),
+                       .threads = 4});
+    CHECK(columns.size() == 2000);
+    CHECK(columns.back() == std::vector<ExcelValue>{4.0, 1.0});
+  }
+}
+
+// run with: zig build run-test -- --no-skip
+// --test-case="BENCHMARK-parallel"
+TEST_CASE("BENCHMARK-parallel" * doctest::skip()) {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_parallel.xlsx");
+  const std::string &path = workbook.path();
+  xlsx_fixture::writeXlsx(
+      path, xlsx_fixture::worksheetXml(xlsx_fixture::numericRows(20000, 50)));
+
+  for (auto parser : {SheetParserKind::Fast, SheetParserKind::Expat}) {
+    for (std::size_t threads : {1, 2, 4, 8}) {
+      auto start = std::chrono::high_resolution_clock::now();
+      auto rows = readAll(path, {.parser = parser, .threads = threads});
+      auto end = std::chrono::high_resolution_clock::now();
+      auto duration =
+          std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+      MESSAGE(parser == SheetParserKind::Fast ? "fast" : "expat",
+              " --threads=", threads, " read ", rows.size(), " rows in: ",
+              duration.count(), " micro-seconds");
+      CHECK(rows.size() == 20000);
+    }
+  }
+}
+
+#endif
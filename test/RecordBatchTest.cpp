@@ -0,0 +1,205 @@
+#include "ExcelReader.h"
+#include "RecordBatch.h"
+#include "XlsxFixture.h"
+#include "doctest/doctest.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using Type = RecordBatch::Column::Type;
+
+TEST_CASE("ExcelReader batches") {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_batches.xlsx");
+  const std::string &path = workbook.path();
+  // A header row, then numbers with a blank, booleans, a mixed column and a
+  // column only the last row has
+  xlsx_fixture::writeXlsx(
+      path,
+      xlsx_fixture::worksheetXml(
+          "<row r=\"1\"><c r=\"A1\" t=\"s\"><v>0</v></c></row>"
+          "<row r=\"2\"><c r=\"A2\"><v>1.5</v></c><c r=\"B2\" t=\"b\"><v>1</v>"
+          "</c><c r=\"C2\" t=\"s\"><v>1</v></c></row>"
+          "<row r=\"3\"><c r=\"A3\" s=\"1\"/><c r=\"B3\" t=\"b\"><v>0</v></c>"
+          "<c r=\"C3\"><v>7</v></c></row>"
+          "<row r=\"4\"><c r=\"A4\"><v>-2</v></c><c r=\"B4\" t=\"b\"><v>1</v>"
+          "</c><c r=\"C4\" t=\"b\"><v>1</v></c><c r=\"D4\" t=\"inlineStr\">"
+          "<is><t>last</t></is></c></row>"),
+      {"header", "x,y"});
+
+  SUBCASE("transposes rows into typed columns") {
+    ExcelReader excelReader;
+    std::vector<RecordBatch> batches;
+    for (const auto &batch : excelReader.readBatches(path, 3)) {
+      batches.push_back(batch);
+    }
+    REQUIRE(batches.size() == 2);
+    CHECK(batches[0].rowCount() == 3);
+    CHECK(batches[1].rowCount() == 1);
+
+    const auto &first = batches[0];
+    REQUIRE(first.columnCount() == 3);
+    // The header makes column A a string column
+    const auto &a = first.column(0);
+    CHECK(a.type() == Type::String);
+    CHECK(a.string(0) == "header");
+    CHECK(a.string(1) == "1.5");
+    CHECK_FALSE(a.isValid(2));
+    CHECK(a.string(2).empty());
+    CHECK(a.offsets().size() == 4);
+
+    const auto &b = first.column(1);
+    CHECK(b.type() == Type::Boolean);
+    CHECK_FALSE(b.isValid(0));
+    CHECK(b.booleans()[1] == 1);
+    CHECK(b.booleans()[2] == 0);
+
+    const auto &c = first.column(2);
+    CHECK(c.type() == Type::String);
+    CHECK(c.string(1) == "x,y");
+    CHECK(c.string(2) == "7");
+
+    const auto &last = batches[1];
+    REQUIRE(last.columnCount() == 4);
+    CHECK(last.column(0).type() == Type::Number);
+    CHECK(last.column(0).numbers()[0] == -2);
+    CHECK(last.column(2).type() == Type::Boolean);
+    CHECK(last.column(3).string(0) == "last");
+  }
+
+  SUBCASE("leaves empty columns null") {
+    ExcelReader excelReader({.skipRows = 2, .maxRows = 1});
+    std::size_t batchCount = 0;
+    for (const auto &batch : excelReader.readBatches(path)) {
+      REQUIRE(batch.columnCount() == 3);
+      CHECK(batch.column(0).type() == Type::Null);
+      CHECK_FALSE(batch.column(0).isValid(0));
+      CHECK(batch.column(2).numbers()[0] == 7);
+      batchCount++;
+    }
+    CHECK(batchCount == 1);
+  }
+}
+
+TEST_CASE("ExcelReader batches match rows") {
+  std::string sample = "./test/fixtures/sample_sheet.xlsx";
+  ExcelReader rowReader({.skipRows = 1});
+  std::vector<std::vector<ExcelValue>> rows;
+  for (const auto &row : rowReader.read(sample)) {
+    rows.push_back(row);
+  }
+
+  ExcelReader batchReader({.skipRows = 1});
+  std::size_t offset = 0;
+  for (const auto &batch : batchReader.readBatches(sample, 64)) {
+    for (std::size_t column = 0; column < batch.columnCount(); ++column) {
+      const auto &values = batch.column(column);
+      for (std::size_t row = 0; row < batch.rowCount(); ++row) {
+        const auto &expected = rows[offset + row][column];
+        if (values.type() == Type::Number) {
+          CHECK(ExcelValue(values.numbers()[row]) == expected);
+        } else {
+          REQUIRE(values.type() == Type::String);
+          CHECK(ExcelValue(std::string(values.string(row))) == expected);
+        }
+      }
+    }
+    offset += batch.rowCount();
+  }
+  CHECK(offset == rows.size());
+}
+
+TEST_CASE("ExcelReader batches span chunks") {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_batch_chunks.xlsx");
+  const std::string &path = workbook.path();
+  std::string rows;
+  for (int row = 1; row <= 5000; ++row) {
+    rows += "<row><c><v>" + std::to_string(row) + "</v></c><c t=\"s\"><v>" +
+            std::to_string(row % 3) + "</v></c></row>";
+  }
+  std::vector<std::string> strings = {"zero", "one", "two"};
+  xlsx_fixture::writeXlsx(path, xlsx_fixture::worksheetXml(rows), strings);
+
+  // Small chunks, so batches take rows from several of the parser's batches
+  // and the parser's batches from several of them
+  for (std::size_t threads : {1, 3}) {
+    for (std::size_t batchRows : {1, 333, 4096}) {
+      ExcelReader excelReader({.chunkSize = 1024,
+                               .skipRows = 7,
+                               .maxRows = 4000,
+                               .threads = threads});
+      std::size_t row = 8;
+      for (const auto &batch : excelReader.readBatches(path, batchRows)) {
+        REQUIRE(batch.columnCount() == 2);
+        for (std::size_t i = 0; i < batch.rowCount(); ++i, ++row) {
+          CHECK(batch.column(0).numbers()[i] == double(row));
+          CHECK(batch.column(1).string(i) == strings[row % 3]);
+        }
+      }
+      CHECK(row == 4008);
+    }
+  }
+}
+
+// run with: zig build run-test -- --no-skip
+// --test-case="BENCHMARK-batches"
+TEST_CASE("BENCHMARK-batches" * doctest::skip()) {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_batches.xlsx");
+  const std::string &path = workbook.path();
+  xlsx_fixture::writeXlsx(
+      path, xlsx_fixture::worksheetXml(xlsx_fixture::numericRows(200000, 10)));
+
+  auto sumRows = [&] {
+    ExcelReader excelReader;
+    double sum = 0;
+    for (const auto &row : excelReader.read(path)) {
+      sum += std::get<double>(row[3]);
+    }
+    return sum;
+  };
+  auto sumBatches = [&] {
+    ExcelReader excelReader;
+    double sum = 0;
+    for (const auto &batch : excelReader.readBatches(path)) {
+      for (double number : batch.column(3).numbers()) {
+        sum += number;
+      }
+    }
+    return sum;
+  };
+
+  // Alternate which reader goes first, and report medians since single
+  // rounds swing widely
+  std::vector<long> rowTimes;
+  std::vector<long> batchTimes;
+  double rowSum = 0;
+  double batchSum = 0;
+  auto time = [](std::vector<long> &times, double &sum, auto &sumOf) {
+    auto start = std::chrono::high_resolution_clock::now();
+    sum = sumOf();
+    auto end = std::chrono::high_resolution_clock::now();
+    times.push_back(static_cast<long>(
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+            .count()));
+  };
+  for (int round = 0; round < 5; ++round) {
+    if (round % 2 == 0) {
+      time(rowTimes, rowSum, sumRows);
+      time(batchTimes, batchSum, sumBatches);
+    } else {
+      time(batchTimes, batchSum, sumBatches);
+      time(rowTimes, rowSum, sumRows);
+    }
+  }
+
+  auto median = [](std::vector<long> &times) {
+    auto middle = times.begin() + times.size() / 2;
+    std::nth_element(times.begin(), middle, times.end());
+    return *middle;
+  };
+  MESSAGE("read() summed a column in (median of 5): ", median(rowTimes),
+          " micro-seconds");
+  MESSAGE("readBatches() summed a column in (median of 5): ",
+          median(batchTimes), " micro-seconds");
+  CHECK(batchSum == rowSum);
+}
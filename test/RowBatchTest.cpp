@@ -0,0 +1,124 @@
+#include "ExcelCell.h"
+#include "ExcelReader.h"
+#include "RowBatch.h"
+#include "XlsxFixture.h"
+#include "doctest/doctest.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+TEST_CASE("ExcelCell") {
+  CHECK(sizeof(ExcelCell) == 16);
+
+  ExcelCell empty;
+  CHECK(empty.kind() == ExcelCell::Kind::String);
+  CHECK(empty.asString().empty());
+  CHECK(ExcelCell::number(4.5).asNumber() == 4.5);
+  CHECK(ExcelCell::boolean(true).asBoolean());
+  CHECK(ExcelCell::sharedString(7).sharedStringIndex() == 7u);
+  CHECK(ExcelCell::numberText("0.10").asNumberText() == "0.10");
+  CHECK(toExcelValue(ExcelCell::numberText("0.10")) == ExcelValue(0.1));
+  CHECK(toExcelValue(ExcelCell::numberText("1e999")) ==
+        ExcelValue(std::string("1e999")));
+
+  std::string text = "text";
+  for (ExcelValue value : {ExcelValue(text), ExcelValue(1.5), ExcelValue(false),
+                           ExcelValue(std::string())}) {
+    CHECK(toExcelValue(toExcelCell(value)) == value);
+  }
+}
+
+namespace {
+
+// One completed row: "first", 1
+RowBatch firstRow() {
+  RowBatch batch;
+  std::string scratch = "first";
+  batch.push(ExcelCell::string(scratch));
+  batch.push(ExcelCell::number(1));
+  batch.completeRow();
+  // The batch keeps its own copy of the bytes
+  scratch = "overwritten";
+  return batch;
+}
+
+} // namespace
+
+TEST_CASE("RowBatch") {
+  SUBCASE("keeps the open row out of takeCompleted()") {
+    RowBatch batch = firstRow();
+    batch.push(ExcelCell::string(std::string(100000, 'x')));
+    auto completed = batch.takeCompleted();
+    CHECK(completed.toValues() ==
+          std::vector<std::vector<ExcelValue>>{{std::string("first"), 1.0}});
+
+    batch.completeRow();
+    auto rest = batch.takeCompleted();
+    REQUIRE(rest.size() == 1);
+    CHECK(rest[0][0].asString() == std::string(100000, 'x'));
+    CHECK(batch.takeCompleted().empty());
+  }
+
+  SUBCASE("fills projected slots") {
+    RowBatch batch = firstRow();
+    batch.resetOpenRow(3);
+    batch.set(2, ExcelCell::string("c"));
+    batch.set(0, ExcelCell::boolean(true));
+    batch.completeRow();
+    CHECK(batch.toValues()[1] ==
+          std::vector<ExcelValue>{true, std::string(), std::string("c")});
+  }
+
+  SUBCASE("copies and appends") {
+    RowBatch batch = firstRow();
+    RowBatch copy = batch;
+    RowBatch other;
+    other.push(ExcelCell::string("second"));
+    other.completeRow();
+    copy.append(std::move(other));
+    CHECK(copy.toValues() == std::vector<std::vector<ExcelValue>>{
+                                 {std::string("first"), 1.0},
+                                 {std::string("second")}});
+    CHECK(batch.size() == 1);
+  }
+}
+
+// run with: zig build run-test -- --no-skip
+// --test-case="BENCHMARK-cells"
+TEST_CASE("BENCHMARK-cells" * doctest::skip()) {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_cells.xlsx");
+  const std::string &path = workbook.path();
+  std::string rows;
+  for (int row = 1; row <= 50000; ++row) {
+    rows += "<row>";
+    for (int column = 0; column < 20; ++column) {
+      rows += column % 2 == 0 ? "<c><v>" + std::to_string(row) + "</v></c>"
+                              : "<c t=\"s\"><v>" + std::to_string(column % 4) +
+                                    "</v></c>";
+    }
+    rows += "</row>";
+  }
+  xlsx_fixture::writeXlsx(path, xlsx_fixture::worksheetXml(rows),
+                          {"a category name past SSO", "short"});
+
+  std::size_t cells = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  ExcelReader cellReader;
+  for (auto row : cellReader.readCells(path)) {
+    cells += row.size();
+  }
+  auto middle = std::chrono::high_resolution_clock::now();
+  ExcelReader valueReader;
+  for (const auto &row : valueReader.read(path)) {
+    cells += row.size();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+
+  auto compact =
+      std::chrono::duration_cast<std::chrono::microseconds>(middle - start);
+  auto variant =
+      std::chrono::duration_cast<std::chrono::microseconds>(end - middle);
+  MESSAGE("readCells: ", compact.count(), " micro-seconds, read: ",
+          variant.count(), " micro-seconds");
+  CHECK(cells == 2 * 50000 * 20);
+}
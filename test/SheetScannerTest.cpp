@@ -0,0 +1,143 @@
+#include "ExcelReader.h"
+#include "SheetScanner.h"
+#include "StringTableReader.h"
+#include "XlsxFixture.h"
+#include "XmlParser.h"
+#include "doctest/doctest.h"
+#include <span>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::vector<ExcelValue>> parseWithExpat(const std::string &xml) {
+  StringTableReader stringTableReader;
+  XmlParser rowParser(stringTableReader);
+  auto parser = XML_ParserCreate(nullptr);
+  rowParser.attach(parser);
+  XML_Parse(parser, xml.data(), static_cast<int>(xml.size()), XML_TRUE);
+  XML_ParserFree(parser);
+  return rowParser.extractCompletedRows().toValues();
+}
+
+// Feeds `xml` in pieces of `pieceSize` bytes, nullopt if the scanner gave up
+std::optional<std::vector<std::vector<ExcelValue>>>
+parseWithScanner(const std::string &xml, std::size_t pieceSize) {
+  StringTableReader stringTableReader;
+  SheetScanner scanner(stringTableReader);
+  auto bytes = std::as_bytes(std::span(xml.data(), xml.size()));
+
+  std::vector<std::vector<ExcelValue>> rows;
+  for (std::size_t offset = 0; offset < bytes.size(); offset += pieceSize) {
+    if (!scanner.feed(bytes.subspan(
+            offset, std::min(pieceSize, bytes.size() - offset)))) {
+      return std::nullopt;
+    }
+    for (auto &row : scanner.extractCompletedRows().toValues()) {
+      rows.push_back(std::move(row));
+    }
+  }
+  if (!scanner.finish()) {
+    return std::nullopt;
+  }
+  return rows;
+}
+
+} // namespace
+
+TEST_CASE("SheetScanner") {
+  SUBCASE("matches expat on every chunk boundary") {
+    std::string xml = xlsx_fixture::worksheetXml(
+        "<row r=\"1\"><c r=\"A1\"><v>1.5</v></c><c r=\"B1\" t=\"b\"><v>1</v>"
+        "</c><c r=\"C1\" s=\"3\"/><c r=\"D1\" t=\"str\"><f>A1*2</f><v>3</v>"
+        "</c></row>\r\n"
+        "<row r=\"2\"><c r=\"A2\" t=\"inlineStr\"><is><r><rPr><b/></rPr>"
+        "<t>bold</t></r><r><t xml:space=\"preserve\"> &amp; plain</t></r>"
+        "</is></c><c r=\"B2\"><v>&#52;&#x32;</v></c><!-- <row> -->"
+        "<c r='C2' t='inlineStr'><is><t>line\r\nbreak &lt;&quot;&gt;</t>"
+        "</is></c></row><row r=\"3\"/>",
+        "<mergeCells count=\"1\"><mergeCell ref=\"A1:B1\"/></mergeCells>");
+    auto expected = parseWithExpat(xml);
+    REQUIRE(expected.size() == 3);
+    CHECK(std::get<std::string>(expected[1][0]) == "bold & plain");
+    CHECK(std::get<std::string>(expected[1][2]) == "line\nbreak <\">");
+
+    for (std::size_t pieceSize = 1; pieceSize <= xml.size(); ++pieceSize) {
+      auto rows = parseWithScanner(xml, pieceSize);
+      REQUIRE_MESSAGE(rows.has_value(), "gave up with pieces of ", pieceSize);
+      REQUIRE_MESSAGE(rows.value() == expected, "mismatch with pieces of ",
+                      pieceSize);
+    }
+  }
+
+  SUBCASE("gives up on CDATA sections") {
+    std::string xml = xlsx_fixture::worksheetXml(
+        "<row><c t=\"inlineStr\"><is><t><![CDATA[x]]></t></is></c></row>");
+    CHECK_FALSE(parseWithScanner(xml, xml.size()).has_value());
+  }
+
+  SUBCASE("gives up on unknown elements inside sheetData") {
+    std::string xml =
+        xlsx_fixture::worksheetXml("<row><c><v>1</v></c><x/></row>");
+    CHECK_FALSE(parseWithScanner(xml, xml.size()).has_value());
+  }
+
+  SUBCASE("gives up on non UTF-8 documents") {
+    std::string xml = "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>"
+                      "<worksheet><sheetData/></worksheet>";
+    CHECK_FALSE(parseWithScanner(xml, xml.size()).has_value());
+  }
+
+  SUBCASE("gives up on truncated sheets") {
+    std::string xml = "<worksheet><sheetData><row><c><v>1</v>";
+    CHECK_FALSE(parseWithScanner(xml, xml.size()).has_value());
+  }
+}
+
+TEST_CASE("ExcelReader falls back to expat") {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_cdata.xlsx");
+  const std::string &path = workbook.path();
+  // The second row can only be read by expat
+  xlsx_fixture::writeXlsx(
+      path,
+      xlsx_fixture::worksheetXml(
+          "<row><c t=\"s\"><v>0</v></c></row>"
+          "<row><c t=\"inlineStr\"><is><t><![CDATA[a,b]]></t></is></c></row>"
+          "<row><c><v>3</v></c></row>"),
+      {"first"});
+
+  ExcelReader expatReader({.parser = SheetParserKind::Expat});
+  std::vector<std::vector<ExcelValue>> expatRows;
+  for (const auto &row : expatReader.read(path)) {
+    expatRows.push_back(row);
+  }
+  REQUIRE(expatRows.size() == 3);
+  CHECK(std::get<std::string>(expatRows[0][0]) == "first");
+  CHECK(std::get<std::string>(expatRows[1][0]) == "a,b");
+
+  // Small chunks make the scanner hand out the first row before giving up
+  for (std::size_t chunkSize : {0, 64}) {
+    ExcelReader fastReader({.chunkSize = chunkSize});
+    std::vector<std::vector<ExcelValue>> fastRows;
+    for (const auto &row : fastReader.read(path)) {
+      fastRows.push_back(row);
+    }
+    CHECK(fastRows == expatRows);
+  }
+}
+
+TEST_CASE("ExcelReader fast and expat parsers agree") {
+  ExcelReader fastReader;
+  std::vector<std::vector<ExcelValue>> fastRows;
+  for (const auto &row : fastReader.read("./test/fixtures/sample_sheet.xlsx")) {
+    fastRows.push_back(row);
+  }
+  ExcelReader expatReader({.parser = SheetParserKind::Expat});
+  std::vector<std::vector<ExcelValue>> expatRows;
+  for (const auto &row :
+       expatReader.read("./test/fixtures/sample_sheet.xlsx")) {
+    expatRows.push_back(row);
+  }
+  CHECK(fastRows.size() == 1001);
+  CHECK(fastRows == expatRows);
+}
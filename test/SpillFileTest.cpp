@@ -0,0 +1,26 @@
+#include "SpillFile.h"
+#include "doctest/doctest.h"
+#include <string>
+#include <utility>
+
+TEST_CASE("SpillFile") {
+  SpillFile file;
+  CHECK(file.append("hello") == 0);
+  CHECK(file.append("") == 5);
+  // Past the write buffer
+  std::string large(3 * 1024 * 1024, 'x');
+  CHECK(file.append(large) == 5);
+  CHECK(file.append("world") == 5 + large.size());
+  file.map();
+
+  SpillFile moved = std::move(file);
+  CHECK(moved.size() == 10 + large.size());
+  CHECK(moved.view(0, 5) == "hello");
+  CHECK(moved.view(5, large.size()) == large);
+  CHECK(moved.view(5 + large.size(), 5) == "world");
+
+  // Mapped again after more appends
+  moved.append("!");
+  moved.map();
+  CHECK(moved.view(10 + large.size(), 1) == "!");
+}
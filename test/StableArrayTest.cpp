@@ -0,0 +1,33 @@
+#include "StableArray.h"
+#include "doctest/doctest.h"
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+TEST_CASE("StableArray") {
+  StableArray<char> bytes(1 << 20);
+  CHECK(bytes.empty());
+  CHECK(bytes.capacity() == 1 << 20);
+  const char *data = bytes.data();
+  bytes.append("hello", 5);
+  bytes.append("", 0);
+  // Filling it never moves what's already there
+  for (int i = 0; i < 1000; ++i) {
+    bytes.append("0123456789", 10);
+  }
+  CHECK(bytes.data() == data);
+  CHECK(bytes.size() == 5 + 10000);
+  CHECK(std::string_view(bytes.data(), 5) == "hello");
+
+  StableArray<std::uint64_t> offsets(4);
+  offsets.push_back(7);
+  offsets.push_back(9);
+  StableArray<std::uint64_t> moved = std::move(offsets);
+  CHECK(offsets.capacity() == 0);
+  REQUIRE(moved.size() == 2);
+  CHECK(moved[1] == 9);
+
+  StableArray<char> none(0);
+  CHECK(none.data() == nullptr);
+  CHECK(none.capacity() == 0);
+}
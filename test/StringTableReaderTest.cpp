@@ -1,6 +1,12 @@
+#include "ExcelReader.h"
+#include "ExcelRow2Csv.h"
 #include "StringTableReader.h"
 #include "Utils.h"
+#include "XlsxFixture.h"
 #include "doctest/doctest.h"
+#include <chrono>
+#include <string>
+#include <vector>
 
 TEST_CASE("StringTableReader") {
   auto file = ZipUtils::open("./test/fixtures/sample_sheet.xlsx").value();
@@ -8,11 +14,195 @@ TEST_CASE("StringTableReader") {
   StringTableReader stringTableReader;
   stringTableReader.collect(file);
 
-  auto entry = stringTableReader.getStringEntry(5);
-
-  REQUIRE(entry.has_value());
-  REQUIRE_MESSAGE(entry.has_value(),
+  REQUIRE_MESSAGE(stringTableReader.size() > 5,
                   "Should contain a string value at index 5");
-  REQUIRE_MESSAGE(entry.value() == "position",
+  auto entry = stringTableReader.getStringEntry(5);
+  REQUIRE_MESSAGE(entry == "position",
                   "Sheet string value at index 5 should match expected value");
-}
\ No newline at end of file
+  CHECK(stringTableReader.viewStringEntry(5) == entry);
+  CHECK_FALSE(
+      stringTableReader.viewStringEntry(stringTableReader.size()).has_value());
+}
+
+TEST_CASE("StringTableReader spills past its budget") {
+  auto file = ZipUtils::open("./test/fixtures/sample_sheet.xlsx").value();
+  StringTableReader inMemory;
+  inMemory.collect(file);
+  CHECK(inMemory.spilledCount() == 0);
+
+  for (std::size_t budget : {std::size_t(0), std::size_t(2000)}) {
+    StringTableReader spilling(budget);
+    spilling.collect(file);
+    CHECK(spilling.spilledCount() > 0);
+    REQUIRE(spilling.size() == inMemory.size());
+    for (std::size_t i = 0; i < inMemory.size(); ++i) {
+      CHECK(spilling.viewStringEntry(i) == inMemory.viewStringEntry(i));
+    }
+    CHECK(spilling.getStringEntry(5) == "position");
+    CHECK_FALSE(spilling.viewStringEntry(spilling.size()).has_value());
+  }
+
+  // The spilled table survives being moved, as ExcelReader does
+  StringTableReader moved(0);
+  moved = [&] {
+    StringTableReader spilling(0);
+    spilling.collect(file);
+    return spilling;
+  }();
+  CHECK(moved.viewStringEntry(5) == "position");
+
+  std::vector<std::string> lines;
+  for (std::size_t budget :
+       {StringTableReader::kDefaultMemoryBudget, std::size_t(0)}) {
+    ExcelReader excelReader({.sharedStringsBudget = budget});
+    std::size_t row = 0;
+    for (auto cells :
+         excelReader.readCells("./test/fixtures/sample_sheet.xlsx")) {
+      auto line = excelRow2Csv(cells, &cells.sharedStrings());
+      if (budget != 0) {
+        lines.push_back(line);
+      } else {
+        CHECK(line == lines[row]);
+      }
+      row++;
+    }
+  }
+}
+
+TEST_CASE("StringTableReader decodes lazily") {
+  auto file = ZipUtils::open("./test/fixtures/sample_sheet.xlsx").value();
+  StringTableReader eager;
+  eager.collect(file);
+
+  for (std::size_t budget :
+       {StringTableReader::kDefaultMemoryBudget, std::size_t(0)}) {
+    StringTableReader lazy(budget, true);
+    lazy.collect(file);
+    CHECK(lazy.isLazy());
+    CHECK(lazy.spilledCount() == 0);
+    REQUIRE(lazy.size() == eager.size());
+    for (std::size_t i = lazy.size(); i-- > 0;) {
+      CHECK(lazy.getStringEntry(i) == eager.getStringEntry(i));
+    }
+    CHECK(lazy.viewStringEntry(5) == "position");
+    CHECK_FALSE(lazy.viewStringEntry(lazy.size()).has_value());
+  }
+
+  std::vector<std::string> lines;
+  for (bool lazy : {false, true}) {
+    ExcelReader excelReader({.sharedStringsBudget = 0,
+                             .lazySharedStrings = lazy});
+    std::size_t row = 0;
+    for (auto cells :
+         excelReader.readCells("./test/fixtures/sample_sheet.xlsx")) {
+      auto line = excelRow2Csv(cells, &cells.sharedStrings());
+      if (!lazy) {
+        lines.push_back(line);
+      } else {
+        CHECK(line == lines[row]);
+      }
+      row++;
+    }
+    CHECK(row == lines.size());
+  }
+}
+
+#ifdef EXCEL2CSV_THREADS
+TEST_CASE("StringTableReader collects in the background") {
+  std::string sample = "./test/fixtures/sample_sheet.xlsx";
+  auto file = ZipUtils::open(sample).value();
+  StringTableReader eager;
+  eager.collect(file);
+
+  // Spilled strings are only ready once collection ended
+  for (std::size_t budget :
+       {StringTableReader::kDefaultMemoryBudget, std::size_t(2000)}) {
+    StringTableReader background(budget);
+    background.collectInBackground(ZipUtils::open(sample).value());
+    for (std::size_t i = 0; i < eager.size(); ++i) {
+      REQUIRE(background.hasStringEntry(i));
+      CHECK(background.getStringEntry(i) == eager.getStringEntry(i));
+    }
+    CHECK_FALSE(background.hasStringEntry(eager.size()));
+    background.finishCollecting();
+    CHECK(background.size() == eager.size());
+    CHECK((background.spilledCount() > 0) == (budget == 2000));
+  }
+
+  xlsx_fixture::TempWorkbook workbook("excel2csv_background.xlsx");
+  const std::string &path = workbook.path();
+  xlsx_fixture::writeZip(
+      path, {{"xl/sharedStrings.xml", "<sst><si><t>first</t></si><si>"}});
+  StringTableReader broken;
+  broken.collectInBackground(ZipUtils::open(path).value());
+  CHECK_THROWS_AS(broken.hasStringEntry(1), MalformedExcelFileException);
+  CHECK_THROWS_AS(broken.finishCollecting(), MalformedExcelFileException);
+
+  // Destroyed while collecting, the thread is stopped and joined
+  StringTableReader abandoned;
+  abandoned.collectInBackground(ZipUtils::open(sample).value());
+}
+#endif
+
+// run with: zig build run-test -- --no-skip
+// --test-case="BENCHMARK-stringSpill"
+TEST_CASE("BENCHMARK-stringSpill" * doctest::skip()) {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_spill.xlsx");
+  const std::string &path = workbook.path();
+  std::vector<std::string> strings;
+  for (std::size_t i = 0; i < 500000; ++i) {
+    strings.push_back("category-" + std::to_string(i * 7919));
+  }
+  xlsx_fixture::writeXlsx(path, xlsx_fixture::worksheetXml(""), strings);
+  auto file = ZipUtils::open(path).value();
+
+  for (std::size_t budget :
+       {StringTableReader::kDefaultMemoryBudget, std::size_t(1 << 20)}) {
+    auto start = std::chrono::high_resolution_clock::now();
+    StringTableReader stringTableReader(budget);
+    stringTableReader.collect(file);
+    std::size_t length = 0;
+    for (std::size_t i = 0; i < stringTableReader.size(); i += 3) {
+      length += stringTableReader.viewStringEntry(i)->size();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    MESSAGE(stringTableReader.spilledCount(), " of ",
+            stringTableReader.size(), " strings spilled, collected and read ",
+            length, " bytes in: ", duration.count(), " micro-seconds");
+  }
+}
+
+// run with: zig build run-test -- --no-skip
+// --test-case="BENCHMARK-lazyStrings"
+TEST_CASE("BENCHMARK-lazyStrings" * doctest::skip()) {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_lazy.xlsx");
+  const std::string &path = workbook.path();
+  std::vector<std::string> strings;
+  for (std::size_t i = 0; i < 500000; ++i) {
+    strings.push_back("category-" + std::to_string(i * 7919));
+  }
+  // The sheet uses one string in 250, as when converting one tab of many
+  std::string rows;
+  for (std::size_t row = 1; row <= strings.size() / 250; ++row) {
+    rows += "<row r=\"" + std::to_string(row) + "\"><c r=\"A" +
+            std::to_string(row) + "\" t=\"s\"><v>" +
+            std::to_string(row * 250 - 1) + "</v></c></row>";
+  }
+  xlsx_fixture::writeXlsx(path, xlsx_fixture::worksheetXml(rows), strings);
+
+  for (bool lazy : {false, true}) {
+    auto start = std::chrono::high_resolution_clock::now();
+    ExcelReader excelReader({.lazySharedStrings = lazy});
+    std::size_t length = 0;
+    for (auto cells : excelReader.readCells(path)) {
+      length += excelRow2Csv(cells, &cells.sharedStrings()).size();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    MESSAGE((lazy ? "lazy" : "eager"), " shared strings, wrote ", length,
+            " bytes in: ", duration.count(), " micro-seconds");
+  }
+}
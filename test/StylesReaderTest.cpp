@@ -0,0 +1,94 @@
+#include "ExcelReader.h"
+#include "StylesReader.h"
+#include "Utils.h"
+#include "XlsxFixture.h"
+#include "doctest/doctest.h"
+#include <string>
+#include <vector>
+
+using xlsx_fixture::readCsv;
+
+namespace {
+
+// Styles 0 to 5: General, yyyy-mm-dd, 0.0%, built-in date 14, built-in
+// fixed 2 and again yyyy-mm-dd
+void writeStyledWorkbook(const std::string &path, const std::string &rows) {
+  xlsx_fixture::writeZip(
+      path,
+      {{"xl/sharedStrings.xml", xlsx_fixture::sharedStringsXml({"when"})},
+       {"xl/styles.xml",
+        xlsx_fixture::stylesXml({{164, "yyyy-mm-dd"}, {165, "0.0%"}},
+                                {0, 164, 165, 14, 2, 164})},
+       {"xl/worksheets/sheet1.xml", xlsx_fixture::worksheetXml(rows)}});
+}
+
+} // namespace
+
+TEST_CASE("StylesReader") {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_styles.xlsx");
+  writeStyledWorkbook(workbook.path(), "");
+  auto archive = ZipUtils::open(workbook.path()).value();
+  std::vector<std::byte> buffer;
+
+  StylesReader styles;
+  styles.collect(archive, buffer);
+  REQUIRE(styles.styleCount() == 6);
+  CHECK(styles.formatOf(0) == 0);
+  CHECK(styles.format(styles.formatOf(1)) == NumberFormat::Kind::Date);
+  CHECK(styles.format(styles.formatOf(2)) ==
+        NumberFormat(NumberFormat::Kind::Percent, 1));
+  // Compiled once per distinct format
+  CHECK(styles.formatOf(3) == styles.formatOf(1));
+  CHECK(styles.formatOf(5) == styles.formatOf(1));
+  // Unknown styles are General
+  CHECK(styles.formatOf(100) == 0);
+}
+
+TEST_CASE("StylesReader without styles") {
+  auto archive = ZipUtils::open("./test/fixtures/basic.zip").value();
+  std::vector<std::byte> buffer;
+  StylesReader styles;
+  styles.collect(archive, buffer);
+  CHECK(styles.styleCount() == 0);
+  CHECK(styles.formatOf(1) == 0);
+}
+
+TEST_CASE("ExcelReader number formats") {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_number_formats.xlsx");
+  const std::string &path = workbook.path();
+  writeStyledWorkbook(
+      path,
+      "<row r=\"1\"><c r=\"A1\" t=\"s\" s=\"1\"><v>0</v></c>"
+      "<c r=\"B1\" s=\"1\"><v>45362</v></c><c r=\"C1\" s=\"2\"><v>0.256</v></c>"
+      "<c r=\"D1\" s=\"4\"><v>3.14159</v></c><c r=\"E1\"><v>45362</v></c>"
+      "<c r=\"F1\" s=\"3\"/></row>");
+
+  for (auto parser : {SheetParserKind::Fast, SheetParserKind::Expat}) {
+    CHECK(readCsv(path, {.parser = parser, .numberFormats = true}) ==
+          std::vector<std::string>{"when,2024-03-11,25.6%,3.14,45362,"});
+    CHECK(readCsv(path, {.parser = parser,
+                         .rawNumbers = true,
+                         .numberFormats = true}) ==
+          std::vector<std::string>{"when,2024-03-11,25.6%,3.14,45362,"});
+    // Opt-in, and typed consumers keep the serial
+    CHECK(readCsv(path, {.parser = parser}) ==
+          std::vector<std::string>{"when,45362,0.256,3.14159,45362,"});
+    ExcelReader excelReader({.parser = parser, .numberFormats = true});
+    for (const auto &row : excelReader.read(path)) {
+      CHECK(row[1] == ExcelValue(45362.0));
+    }
+  }
+}
+
+TEST_CASE("ExcelReader number formats with a non-numeric style") {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_odd_style.xlsx");
+  const std::string &path = workbook.path();
+  writeStyledWorkbook(path, "<row r=\"1\"><c r=\"A1\" s=\" 2\"><v>0.256</v></c>"
+                            "<c r=\"B1\" s=\"1\"><v>45362</v></c></row>");
+
+  // The fast scanner leaves it to expat, so both read it alike
+  for (auto parser : {SheetParserKind::Fast, SheetParserKind::Expat}) {
+    CHECK(readCsv(path, {.parser = parser, .numberFormats = true}) ==
+          std::vector<std::string>{"25.6%,2024-03-11"});
+  }
+}
@@ -13,6 +13,95 @@ TEST_CASE("ZipUtils") {
   CHECK(output_string == "123\n");
 }
 
+TEST_CASE("ZipUtils stored entries") {
+  auto file =
+      ZipUtils::open("./test/fixtures/sample_sheet_stored.xlsx").value();
+  const ZipEntry *entry = file.find("xl/sharedStrings.xml");
+  REQUIRE(entry != nullptr);
+
+  int chunkCount = 0;
+  std::size_t total = 0;
+  for (const auto &chunk :
+       ZipUtils::readFileChunked(file, "xl/sharedStrings.xml")) {
+    // Views point straight into the mapped archive, no copy
+    CHECK(chunk.data() == file.entryData(*entry).data());
+    total += chunk.size();
+    chunkCount++;
+  }
+  CHECK(chunkCount == 1);
+  CHECK(total == entry->uncompressedSize);
+}
+
+TEST_CASE("ZipUtils chunk size") {
+  auto file = ZipUtils::open("./test/fixtures/sample_sheet.xlsx").value();
+
+  SUBCASE("honours an explicit chunk size") {
+    std::size_t total = 0;
+    for (const auto &chunk : ZipUtils::readFileChunked(
+             file, "xl/worksheets/sheet1.xml", {.chunkSize = 1000})) {
+      CHECK(chunk.size() <= 1000);
+      total += chunk.size();
+    }
+    CHECK(total == file.find("xl/worksheets/sheet1.xml")->uncompressedSize);
+  }
+
+  SUBCASE("reuses the caller's buffer across entries") {
+    std::vector<std::byte> buffer;
+    for (const auto &chunk : ZipUtils::readFileChunked(
+             file, "xl/sharedStrings.xml", buffer, {.chunkSize = 4096})) {
+      CHECK(chunk.data() == buffer.data());
+    }
+    const std::byte *firstAllocation = buffer.data();
+    for (const auto &chunk : ZipUtils::readFileChunked(
+             file, "xl/worksheets/sheet1.xml", buffer, {.chunkSize = 4096})) {
+      CHECK(chunk.data() == firstAllocation);
+    }
+    CHECK(buffer.size() == 4096);
+  }
+
+  SUBCASE("adapts to the entry size") {
+    CHECK(ZipUtils::chunkSizeFor(0) == 64 * 1024);
+    CHECK(ZipUtils::chunkSizeFor(397429) == 64 * 1024);
+    CHECK(ZipUtils::chunkSizeFor(64ull * 1024 * 1024) == 256 * 1024);
+    CHECK(ZipUtils::chunkSizeFor(4ull * 1024 * 1024 * 1024) == 1024 * 1024);
+  }
+}
+
+#ifdef EXCEL2CSV_THREADS
+TEST_CASE("ZipUtils pipelined") {
+  auto file = ZipUtils::open("./test/fixtures/sample_sheet.xlsx").value();
+
+  std::string expected;
+  for (const auto &chunk :
+       ZipUtils::readFileChunked(file, "xl/worksheets/sheet1.xml")) {
+    expected.append(reinterpret_cast<const char *>(chunk.data()),
+                    chunk.size());
+  }
+
+  SUBCASE("produces the same bytes as the serial reader") {
+    std::string output_string;
+    for (const auto &chunk : ZipUtils::readFileChunked(
+             file, "xl/worksheets/sheet1.xml", {.pipelined = true})) {
+      output_string.append(reinterpret_cast<const char *>(chunk.data()),
+                           chunk.size());
+    }
+    CHECK(output_string == expected);
+  }
+
+  SUBCASE("stops the inflate thread when the consumer stops early") {
+    int chunkCount = 0;
+    for (const auto &chunk : ZipUtils::readFileChunked(
+             file, "xl/worksheets/sheet1.xml", {.pipelined = true})) {
+      CHECK(!chunk.empty());
+      if (++chunkCount == 2) {
+        break;
+      }
+    }
+    CHECK(chunkCount == 2);
+  }
+}
+#endif
+
 TEST_CASE("stringToNumber") {
   SUBCASE("extracts number from string with letters before") {
     CHECK(stringToNumber("dskjt31") == 31);
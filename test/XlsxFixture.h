@@ -0,0 +1,251 @@
+#pragma once
+
+// Builds minimal workbooks on the fly for tests and benchmarks that need
+// sheets the checked-in fixtures don't cover.
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <zlib.h>
+
+#include "ExcelReader.h"
+#include "ExcelRow2Csv.h"
+#include "ExcelValue.h"
+
+namespace xlsx_fixture {
+
+// Path of a workbook in the temporary directory, removed when the guard
+// goes, a failed REQUIRE included
+class TempWorkbook {
+private:
+  std::string m_path;
+
+public:
+  explicit TempWorkbook(const std::string &name)
+      : m_path((std::filesystem::temp_directory_path() / name).string()) {}
+  TempWorkbook(const TempWorkbook &) = delete;
+  TempWorkbook &operator=(const TempWorkbook &) = delete;
+  ~TempWorkbook() {
+    std::error_code error;
+    std::filesystem::remove(m_path, error);
+  }
+
+  const std::string &path() const { return m_path; }
+};
+
+inline void putU16(std::string &out, std::uint16_t value) {
+  out += static_cast<char>(value & 0xFF);
+  out += static_cast<char>(value >> 8);
+}
+
+inline void putU32(std::string &out, std::uint32_t value) {
+  putU16(out, static_cast<std::uint16_t>(value & 0xFFFF));
+  putU16(out, static_cast<std::uint16_t>(value >> 16));
+}
+
+inline std::string deflateRaw(const std::string &content) {
+  z_stream stream{};
+  deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+               Z_DEFAULT_STRATEGY);
+  std::string out(deflateBound(&stream, content.size()), '\0');
+  stream.next_in =
+      reinterpret_cast<Bytef *>(const_cast<char *>(content.data()));
+  stream.avail_in = static_cast<uInt>(content.size());
+  stream.next_out = reinterpret_cast<Bytef *>(out.data());
+  stream.avail_out = static_cast<uInt>(out.size());
+  deflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+  return out;
+}
+
+// Writes a ZIP archive holding `entries` (name, content), deflated unless
+// `stored` is set.
+inline void
+writeZip(const std::string &path,
+         const std::vector<std::pair<std::string, std::string>> &entries,
+         bool stored = false) {
+  std::string archive;
+  std::string directory;
+
+  for (const auto &[name, content] : entries) {
+    std::string data = stored ? content : deflateRaw(content);
+    auto crc = static_cast<std::uint32_t>(crc32(
+        0, reinterpret_cast<const Bytef *>(content.data()),
+        static_cast<uInt>(content.size())));
+    auto offset = static_cast<std::uint32_t>(archive.size());
+    std::uint16_t method = stored ? 0 : 8;
+
+    putU32(archive, 0x04034b50);
+    putU16(archive, 20);
+    putU16(archive, 0);
+    putU16(archive, method);
+    putU32(archive, 0);
+    putU32(archive, crc);
+    putU32(archive, static_cast<std::uint32_t>(data.size()));
+    putU32(archive, static_cast<std::uint32_t>(content.size()));
+    putU16(archive, static_cast<std::uint16_t>(name.size()));
+    putU16(archive, 0);
+    archive += name;
+    archive += data;
+
+    putU32(directory, 0x02014b50);
+    putU16(directory, 20);
+    putU16(directory, 20);
+    putU16(directory, 0);
+    putU16(directory, method);
+    putU32(directory, 0);
+    putU32(directory, crc);
+    putU32(directory, static_cast<std::uint32_t>(data.size()));
+    putU32(directory, static_cast<std::uint32_t>(content.size()));
+    putU16(directory, static_cast<std::uint16_t>(name.size()));
+    putU16(directory, 0);
+    putU16(directory, 0);
+    putU16(directory, 0);
+    putU16(directory, 0);
+    putU32(directory, 0);
+    putU32(directory, offset);
+    directory += name;
+  }
+
+  auto directoryOffset = static_cast<std::uint32_t>(archive.size());
+  archive += directory;
+  putU32(archive, 0x06054b50);
+  putU16(archive, 0);
+  putU16(archive, 0);
+  putU16(archive, static_cast<std::uint16_t>(entries.size()));
+  putU16(archive, static_cast<std::uint16_t>(entries.size()));
+  putU32(archive, static_cast<std::uint32_t>(directory.size()));
+  putU32(archive, directoryOffset);
+  putU16(archive, 0);
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(archive.data(), static_cast<std::streamsize>(archive.size()));
+}
+
+inline std::string sharedStringsXml(const std::vector<std::string> &strings) {
+  std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                    "<sst xmlns=\"http://schemas.openxmlformats.org/"
+                    "spreadsheetml/2006/main\">";
+  for (const auto &string : strings) {
+    xml += "<si><t>" + string + "</t></si>";
+  }
+  return xml + "</sst>";
+}
+
+// Styles with the custom number formats `numFmts` (numFmtId, formatCode) and
+// one cell style per entry of `styleFormats`, its numFmtId
+inline std::string
+stylesXml(const std::vector<std::pair<int, std::string>> &numFmts,
+          const std::vector<int> &styleFormats) {
+  std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                    "<styleSheet xmlns=\"http://schemas.openxmlformats.org/"
+                    "spreadsheetml/2006/main\"><numFmts>";
+  for (const auto &[id, code] : numFmts) {
+    xml += "<numFmt numFmtId=\"" + std::to_string(id) + "\" formatCode=\"" +
+           code + "\"/>";
+  }
+  // Cell style formats don't apply to cells
+  xml += "</numFmts><cellStyleXfs><xf numFmtId=\"14\"/></cellStyleXfs>"
+         "<cellXfs>";
+  for (int id : styleFormats) {
+    xml += "<xf numFmtId=\"" + std::to_string(id) + "\" xfId=\"0\"/>";
+  }
+  return xml + "</cellXfs></styleSheet>";
+}
+
+// Wraps `rows` (the markup of <row> elements) into a worksheet, followed by
+// `trailer` after </sheetData>.
+inline std::string worksheetXml(const std::string &rows,
+                                const std::string &trailer = "") {
+  return "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>"
+         "<worksheet xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/"
+         "2006/main\" xmlns:r=\"http://schemas.openxmlformats.org/"
+         "officeDocument/2006/relationships\"><dimension ref=\"A1\"/>"
+         "<sheetData>" +
+         rows + "</sheetData>" + trailer + "</worksheet>";
+}
+
+// Name of the zero-based `column`: A, B, ..., Z, AA, ...
+inline std::string columnName(int column) {
+  std::string name;
+  for (++column; column > 0; column = (column - 1) / 26) {
+    name.insert(name.begin(), static_cast<char>('A' + (column - 1) % 26));
+  }
+  return name;
+}
+
+// `rowCount` rows of `columnCount` numeric cells (columns A, B, ...)
+inline std::string numericRows(int rowCount, int columnCount) {
+  std::string rows;
+  for (int row = 1; row <= rowCount; ++row) {
+    rows += "<row r=\"" + std::to_string(row) + "\">";
+    for (int column = 0; column < columnCount; ++column) {
+      rows += "<c r=\"" + columnName(column) + std::to_string(row) +
+              "\"><v>" + std::to_string(column) + "</v></c>";
+    }
+    rows += "</row>";
+  }
+  return rows;
+}
+
+// What typically follows <sheetData>: `count` merged ranges, hyperlinks and
+// conditional formats
+inline std::string heavyTrailer(int count) {
+  std::string trailer = "<mergeCells count=\"" + std::to_string(count) + "\">";
+  for (int i = 1; i <= count; ++i) {
+    trailer += "<mergeCell ref=\"A" + std::to_string(i) + ":C" +
+               std::to_string(i) + "\"/>";
+  }
+  trailer += "</mergeCells>";
+  for (int i = 1; i <= count; ++i) {
+    trailer += "<conditionalFormatting sqref=\"D" + std::to_string(i) +
+               "\"><cfRule type=\"cellIs\" dxfId=\"0\" priority=\"" +
+               std::to_string(i) +
+               "\" operator=\"greaterThan\"><formula>0</formula></cfRule>"
+               "</conditionalFormatting>";
+  }
+  trailer += "<hyperlinks>";
+  for (int i = 1; i <= count; ++i) {
+    trailer += "<hyperlink ref=\"E" + std::to_string(i) + "\" r:id=\"rId" +
+               std::to_string(i) + "\"/>";
+  }
+  return trailer + "</hyperlinks>";
+}
+
+inline void writeXlsx(const std::string &path, const std::string &sheetXml,
+                      const std::vector<std::string> &sharedStrings = {},
+                      bool stored = false) {
+  writeZip(path,
+           {{"xl/sharedStrings.xml", sharedStringsXml(sharedStrings)},
+            {"xl/worksheets/sheet1.xml", sheetXml}},
+           stored);
+}
+
+// Every row of the workbook at `path`, as ExcelValues
+inline std::vector<std::vector<ExcelValue>>
+readAll(const std::string &path, ExcelReaderOptions options = {}) {
+  ExcelReader reader(options);
+  std::vector<std::vector<ExcelValue>> rows;
+  for (const auto &row : reader.read(path)) {
+    rows.push_back(row);
+  }
+  return rows;
+}
+
+// Every row of the workbook at `path`, as the CSV writer writes it
+inline std::vector<std::string> readCsv(const std::string &path,
+                                        ExcelReaderOptions options = {}) {
+  ExcelReader reader(options);
+  std::vector<std::string> lines;
+  for (auto row : reader.readCells(path)) {
+    lines.push_back(excelRow2Csv(row, &row.sharedStrings(), &row.styles()));
+  }
+  return lines;
+}
+
+} // namespace xlsx_fixture
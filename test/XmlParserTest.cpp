@@ -0,0 +1,326 @@
+#include "ExcelReader.h"
+#include "StringTableReader.h"
+#include "Utils.h"
+#include "XlsxFixture.h"
+#include "XmlParser.h"
+#include "doctest/doctest.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+// Counter of the AllocationCount alive on this thread, if any. The
+// replacements below are global, they only count while one is
+static thread_local std::size_t *currentAllocationCount = nullptr;
+
+void *operator new(std::size_t size) {
+  if (currentAllocationCount != nullptr) {
+    ++*currentAllocationCount;
+  }
+  if (void *pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  if (currentAllocationCount != nullptr) {
+    ++*currentAllocationCount;
+  }
+  auto align = static_cast<std::size_t>(alignment);
+  // aligned_alloc wants a multiple of the alignment
+  std::size_t rounded = (std::max<std::size_t>(size, 1) + align - 1) /
+                        align * align;
+  if (void *pointer = std::aligned_alloc(align, rounded)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+// Memory from both malloc and aligned_alloc goes back through free, which
+// GCC can't tell matches once these are inlined
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+void operator delete(void *pointer, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+#pragma GCC diagnostic pop
+
+namespace {
+
+// Counts this thread's allocations while alive, other suites and threads
+// aren't counted
+class AllocationCount {
+private:
+  std::size_t m_count = 0;
+
+public:
+  AllocationCount() { currentAllocationCount = &m_count; }
+  AllocationCount(const AllocationCount &) = delete;
+  AllocationCount &operator=(const AllocationCount &) = delete;
+  ~AllocationCount() { currentAllocationCount = nullptr; }
+
+  std::size_t count() const { return m_count; }
+};
+
+std::vector<std::vector<ExcelValue>>
+parseSheet(const std::string &path, ZipReadOptions options) {
+  auto archive = ZipUtils::open(path).value();
+  StringTableReader stringTableReader;
+  XmlParser rowParser(stringTableReader);
+  auto parser = createXmlParser();
+  rowParser.attach(parser.get());
+
+  std::vector<std::byte> buffer;
+  std::vector<std::vector<ExcelValue>> rows;
+  for ([[maybe_unused]] auto parsedBytes :
+       parseZipEntry(parser.get(), archive, "xl/worksheets/sheet1.xml",
+                     buffer, options)) {
+    for (auto &row : rowParser.extractCompletedRows().toValues()) {
+      rows.push_back(std::move(row));
+    }
+  }
+  for (auto &row : rowParser.extractCompletedRows().toValues()) {
+    rows.push_back(std::move(row));
+  }
+  return rows;
+}
+
+// Parses `rowCount` rows of `columnCount` cells too long for the small string
+// optimisation and returns how many allocations that took.
+std::size_t countParseAllocations(int rowCount, int columnCount) {
+  std::string rows;
+  for (int row = 0; row < rowCount; ++row) {
+    rows += "<row>";
+    for (int column = 0; column < columnCount; ++column) {
+      rows += column % 2 == 0 ? "<c><v>1234567.89012345678</v></c>"
+                              : "<c t=\"b\"><v>0000000000000000001</v></c>";
+    }
+    rows += "</row>";
+  }
+  std::string xml = xlsx_fixture::worksheetXml(rows);
+
+  StringTableReader stringTableReader;
+  XmlParser rowParser(stringTableReader);
+  auto parser = createXmlParser();
+  rowParser.attach(parser.get());
+
+  std::size_t allocations = 0;
+  {
+    AllocationCount count;
+    XML_Parse(parser.get(), xml.data(), static_cast<int>(xml.size()),
+              XML_TRUE);
+    allocations = count.count();
+  }
+
+  auto parsedRows = rowParser.extractCompletedRows();
+  REQUIRE(parsedRows.size() == static_cast<std::size_t>(rowCount));
+  CHECK(parsedRows[rowCount - 1].size() ==
+        static_cast<std::size_t>(columnCount));
+  return allocations;
+}
+
+} // namespace
+
+TEST_CASE("XmlParser allocations") {
+  // Only the batch's storage grows, neither rows nor cells cost anything
+  std::size_t narrow = countParseAllocations(200, 10);
+  std::size_t wide = countParseAllocations(200, 50);
+  MESSAGE("allocations: ", narrow, " for 2000 cells, ", wide,
+          " for 10000 cells");
+  CHECK(wide - narrow <= 8);
+  CHECK(wide < 64);
+}
+
+TEST_CASE("ExcelReader allocations") {
+  // Once the batches are warmed up, reading more rows allocates nothing
+  xlsx_fixture::TempWorkbook workbook("excel2csv_allocations.xlsx");
+  const std::string &path = workbook.path();
+  auto countReadAllocations = [&](int rowCount, SheetParserKind parser) {
+    std::string rows;
+    for (int row = 1; row <= rowCount; ++row) {
+      rows += "<row><c t=\"s\"><v>" + std::to_string(row % 3) +
+              "</v></c><c><v>" + std::to_string(row) +
+              ".25</v></c><c t=\"inlineStr\"><is><t>inline text past the "
+              "small string buffer</t></is></c></row>";
+    }
+    xlsx_fixture::writeXlsx(
+        path, xlsx_fixture::worksheetXml(rows),
+        {"a shared string past the small string buffer", "b", "c"});
+
+    ExcelReader reader({.parser = parser, .chunkSize = 16 * 1024});
+    std::size_t cells = 0;
+    std::size_t allocations = 0;
+    {
+      AllocationCount count;
+      for (auto row : reader.readCells(path)) {
+        cells += row.size();
+      }
+      allocations = count.count();
+    }
+    CHECK(cells == static_cast<std::size_t>(rowCount) * 3);
+    return allocations;
+  };
+
+  for (auto parser : {SheetParserKind::Fast, SheetParserKind::Expat}) {
+    std::size_t small = countReadAllocations(5000, parser);
+    std::size_t large = countReadAllocations(40000, parser);
+    MESSAGE(parser == SheetParserKind::Fast ? "fast" : "expat",
+            " allocations: ", small, " for 5000 rows, ", large,
+            " for 40000 rows");
+    CHECK(large - small <= 16);
+  }
+}
+
+TEST_CASE("parseZipEntry") {
+  xlsx_fixture::TempWorkbook deflatedWorkbook("excel2csv_feed.xlsx");
+  xlsx_fixture::TempWorkbook storedWorkbook("excel2csv_feed_stored.xlsx");
+  const std::string &deflatedPath = deflatedWorkbook.path();
+  const std::string &storedPath = storedWorkbook.path();
+  std::string sheet =
+      xlsx_fixture::worksheetXml(xlsx_fixture::numericRows(2000, 5));
+  xlsx_fixture::writeXlsx(deflatedPath, sheet);
+  xlsx_fixture::writeXlsx(storedPath, sheet, {}, true);
+
+  SUBCASE("inflates into expat's buffer at any chunk size") {
+    auto expected = parseSheet(storedPath, {});
+    REQUIRE(expected.size() == 2000);
+    CHECK(std::get<double>(expected[1999][4]) == 4.0);
+
+    for (std::size_t chunkSize : {0, 1, 100, 4096}) {
+      CHECK(parseSheet(deflatedPath, {.chunkSize = chunkSize}) == expected);
+    }
+  }
+
+  SUBCASE("stops inflating once the row range is done") {
+    auto archive = ZipUtils::open(deflatedPath).value();
+    StringTableReader stringTableReader;
+    ExcelRowBuilder rowBuilder;
+    rowBuilder.limitRows(3, 5);
+    XmlParser rowParser(stringTableReader, std::move(rowBuilder));
+    auto parser = createXmlParser();
+    rowParser.attach(parser.get());
+
+    std::vector<std::byte> buffer;
+    std::size_t total = 0;
+    for (auto parsedBytes :
+         parseZipEntry(parser.get(), archive, "xl/worksheets/sheet1.xml",
+                       buffer, {.chunkSize = 4096})) {
+      total += parsedBytes;
+    }
+    CHECK(total < 3 * 4096);
+
+    auto all = parseSheet(storedPath, {});
+    CHECK(rowParser.extractCompletedRows().toValues() ==
+          decltype(all)(all.begin() + 3, all.begin() + 8));
+  }
+
+  SUBCASE("stops inflating at </sheetData>") {
+    // The broken trailer is never parsed
+    std::string rows = xlsx_fixture::numericRows(10, 5);
+    xlsx_fixture::writeXlsx(
+        deflatedPath,
+        xlsx_fixture::worksheetXml(
+            rows, xlsx_fixture::heavyTrailer(5000) + "<unclosed>"));
+    auto archive = ZipUtils::open(deflatedPath).value();
+    StringTableReader stringTableReader;
+    XmlParser rowParser(stringTableReader);
+    auto parser = createXmlParser();
+    rowParser.attach(parser.get());
+
+    std::vector<std::byte> buffer;
+    std::size_t total = 0;
+    for (auto parsedBytes :
+         parseZipEntry(parser.get(), archive, "xl/worksheets/sheet1.xml",
+                       buffer, {.chunkSize = 4096})) {
+      total += parsedBytes;
+    }
+    CHECK(rowParser.isDone());
+    CHECK(total < rows.size() + 2 * 4096);
+    CHECK(rowParser.extractCompletedRows().size() == 10);
+  }
+
+  SUBCASE("reports malformed XML") {
+    std::string truncated = sheet.substr(0, sheet.size() / 2) + "</bogus>";
+    for (bool stored : {false, true}) {
+      xlsx_fixture::writeXlsx(deflatedPath, truncated, {}, stored);
+      CHECK_THROWS_AS(parseSheet(deflatedPath, {}),
+                      MalformedExcelFileException);
+    }
+  }
+}
+
+// run with: zig build run-test -- --no-skip
+// --test-case="BENCHMARK-expatFeed"
+TEST_CASE("BENCHMARK-expatFeed" * doctest::skip()) {
+  xlsx_fixture::TempWorkbook workbook("excel2csv_feed_bench.xlsx");
+  const std::string &path = workbook.path();
+  std::string sheet =
+      xlsx_fixture::worksheetXml(xlsx_fixture::numericRows(100000, 10));
+  xlsx_fixture::writeXlsx(path, sheet);
+  auto archive = ZipUtils::open(path).value();
+  double megabytes = static_cast<double>(sheet.size()) / (1024 * 1024);
+
+  auto feedXmlParse = [&] {
+    std::vector<std::byte> buffer;
+    auto parser = createXmlParser();
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto &chunk : ZipUtils::readFileChunked(
+             archive, "xl/worksheets/sheet1.xml", buffer)) {
+      XML_Parse(parser.get(), reinterpret_cast<const char *>(chunk.data()),
+                static_cast<int>(chunk.size()), XML_FALSE);
+    }
+    CHECK(XML_Parse(parser.get(), nullptr, 0, XML_TRUE) == XML_STATUS_OK);
+    return std::chrono::high_resolution_clock::now() - start;
+  };
+  auto feedParseZipEntry = [&] {
+    std::vector<std::byte> buffer;
+    auto parser = createXmlParser();
+    auto start = std::chrono::high_resolution_clock::now();
+    std::size_t total = 0;
+    for (auto parsedBytes : parseZipEntry(
+             parser.get(), archive, "xl/worksheets/sheet1.xml", buffer, {})) {
+      total += parsedBytes;
+    }
+    CHECK(total == sheet.size());
+    return std::chrono::high_resolution_clock::now() - start;
+  };
+
+  // Alternate which feed goes first so neither always pays the warm-up, and
+  // report medians since single rounds swing widely
+  std::vector<long> xmlParseTimes;
+  std::vector<long> parseZipEntryTimes;
+  auto micros = [](auto duration) {
+    return static_cast<long>(
+        std::chrono::duration_cast<std::chrono::microseconds>(duration)
+            .count());
+  };
+  for (int round = 0; round < 9; ++round) {
+    if (round % 2 == 0) {
+      xmlParseTimes.push_back(micros(feedXmlParse()));
+      parseZipEntryTimes.push_back(micros(feedParseZipEntry()));
+    } else {
+      parseZipEntryTimes.push_back(micros(feedParseZipEntry()));
+      xmlParseTimes.push_back(micros(feedXmlParse()));
+    }
+  }
+
+  auto report = [&](const char *name, std::vector<long> &times) {
+    auto middle = times.begin() + times.size() / 2;
+    std::nth_element(times.begin(), middle, times.end());
+    MESSAGE(name, " parsed ", sheet.size(), " bytes in (median of ",
+            times.size(), "): ", *middle, " micro-seconds (",
+            megabytes * 1000000 / std::max<long>(*middle, 1), " MB/s)");
+  };
+  report("XML_Parse", xmlParseTimes);
+  report("parseZipEntry", parseZipEntryTimes);
+}
@@ -0,0 +1,126 @@
+#include "StringTableReader.h"
+#include "XlsxFixture.h"
+#include "XmlParser.h"
+#include "XmlTag.h"
+#include "doctest/doctest.h"
+#include "expat.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <string>
+
+TEST_CASE("classifyTag") {
+  CHECK(classifyTag("sheetData") == XmlTag::SheetData);
+  CHECK(classifyTag("row") == XmlTag::Row);
+  CHECK(classifyTag("c") == XmlTag::C);
+  CHECK(classifyTag("v") == XmlTag::V);
+  CHECK(classifyTag("f") == XmlTag::F);
+  CHECK(classifyTag("is") == XmlTag::Is);
+  CHECK(classifyTag("t") == XmlTag::T);
+  CHECK(classifyTag("si") == XmlTag::Si);
+
+  CHECK(classifyTag("") == XmlTag::Unknown);
+  CHECK(classifyTag("r") == XmlTag::Unknown);
+  CHECK(classifyTag("rPr") == XmlTag::Unknown);
+  CHECK(classifyTag("sheetDat") == XmlTag::Unknown);
+  CHECK(classifyTag("sheetDataX") == XmlTag::Unknown);
+  CHECK(classifyTag("worksheet") == XmlTag::Unknown);
+  CHECK(classifyTag("mergeCell") == XmlTag::Unknown);
+}
+
+namespace {
+
+// The strcmp chain the parsers used before classifyTag
+XmlTag classifyTagWithStrcmp(const char *name) {
+  if (strcmp(name, "sheetData") == 0) {
+    return XmlTag::SheetData;
+  } else if (strcmp(name, "row") == 0) {
+    return XmlTag::Row;
+  } else if (strcmp(name, "c") == 0) {
+    return XmlTag::C;
+  } else if (strcmp(name, "v") == 0) {
+    return XmlTag::V;
+  } else if (strcmp(name, "f") == 0) {
+    return XmlTag::F;
+  } else if (strcmp(name, "is") == 0) {
+    return XmlTag::Is;
+  } else if (strcmp(name, "t") == 0) {
+    return XmlTag::T;
+  } else if (strcmp(name, "si") == 0) {
+    return XmlTag::Si;
+  }
+  return XmlTag::Unknown;
+}
+
+XmlTag classifyTagWithHash(const char *name) { return classifyTag(name); }
+
+struct TagCounter {
+  std::array<std::size_t, 16> counts{};
+  std::size_t callbacks = 0;
+};
+
+template <XmlTag (*Classify)(const char *)>
+void XMLCALL countStart(void *userData, const char *name, const char **) {
+  auto counter = static_cast<TagCounter *>(userData);
+  counter->counts[static_cast<std::size_t>(Classify(name))]++;
+  counter->callbacks++;
+}
+
+template <XmlTag (*Classify)(const char *)>
+void XMLCALL countEnd(void *userData, const char *name) {
+  auto counter = static_cast<TagCounter *>(userData);
+  counter->counts[static_cast<std::size_t>(Classify(name))]++;
+  counter->callbacks++;
+}
+
+template <XmlTag (*Classify)(const char *)>
+TagCounter countTags(const std::string &xml) {
+  TagCounter counter;
+  auto parser = XML_ParserCreate(nullptr);
+  XML_SetUserData(parser, &counter);
+  XML_SetElementHandler(parser, countStart<Classify>, countEnd<Classify>);
+  XML_Parse(parser, xml.data(), static_cast<int>(xml.size()), XML_TRUE);
+  XML_ParserFree(parser);
+  return counter;
+}
+
+} // namespace
+
+// run with: zig build run-test -- --no-skip
+// --test-case="BENCHMARK-tagDispatch"
+TEST_CASE("BENCHMARK-tagDispatch" * doctest::skip()) {
+  std::string xml =
+      xlsx_fixture::worksheetXml(xlsx_fixture::numericRows(100000, 10));
+
+  auto measure = [&](const char *name, auto countTagsFn) {
+    auto start = std::chrono::high_resolution_clock::now();
+    TagCounter counter = countTagsFn(xml);
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    MESSAGE(name, " handled ", counter.callbacks, " callbacks in ",
+            duration.count(), " micro-seconds (",
+            counter.callbacks * 1000000 / std::max<long>(duration.count(), 1),
+            " callbacks/s)");
+    return counter;
+  };
+
+  auto before = measure("strcmp", countTags<classifyTagWithStrcmp>);
+  auto after = measure("classifyTag", countTags<classifyTagWithHash>);
+  CHECK(before.counts == after.counts);
+  CHECK(after.counts[static_cast<std::size_t>(XmlTag::C)] == 2000000);
+
+  StringTableReader stringTableReader;
+  XmlParser rowParser(stringTableReader);
+  auto parser = XML_ParserCreate(nullptr);
+  rowParser.attach(parser);
+  auto start = std::chrono::high_resolution_clock::now();
+  XML_Parse(parser, xml.data(), static_cast<int>(xml.size()), XML_TRUE);
+  auto end = std::chrono::high_resolution_clock::now();
+  XML_ParserFree(parser);
+  auto duration =
+      std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+  MESSAGE("XmlParser built ", rowParser.extractCompletedRows().size(),
+          " rows in ", duration.count(), " micro-seconds");
+}
@@ -0,0 +1,83 @@
+#include "Utils.h"
+#include "ZipArchive.h"
+#include "doctest/doctest.h"
+#include <chrono>
+#include <optional>
+#include <utility>
+#include <vector>
+
+TEST_CASE("ZipArchive") {
+  SUBCASE("returns nullopt for a missing file") {
+    CHECK_FALSE(ZipArchive::open("./test/fixtures/missing.zip").has_value());
+  }
+
+  SUBCASE("returns nullopt for a file that isn't a ZIP archive") {
+    CHECK_FALSE(ZipArchive::open("./test/TestMain.cpp").has_value());
+  }
+
+  SUBCASE("locates entries through the central directory") {
+    auto archive =
+        ZipArchive::open("./test/fixtures/sample_sheet.xlsx").value();
+    CHECK(archive.find("xl/sharedStrings.xml") != nullptr);
+    CHECK(archive.find("xl/worksheets/sheet1.xml") != nullptr);
+    CHECK(archive.find("xl/worksheets/sheet99.xml") == nullptr);
+  }
+
+  SUBCASE("inflates the whole entry") {
+    auto archive =
+        ZipArchive::open("./test/fixtures/sample_sheet.xlsx").value();
+    ZipEntryReader reader(archive, "xl/worksheets/sheet1.xml");
+
+    std::vector<std::byte> buffer(1000);
+    std::size_t total = 0;
+    std::size_t bytesRead;
+    while ((bytesRead = reader.read(buffer)) > 0) {
+      total += bytesRead;
+    }
+    CHECK(total == reader.entry().uncompressedSize);
+  }
+
+  SUBCASE("throws for an entry that doesn't exist") {
+    auto archive = ZipArchive::open("./test/fixtures/basic.zip").value();
+    CHECK_THROWS_AS(ZipEntryReader(archive, "missing.txt"),
+                    MalformedZipFileException);
+  }
+}
+
+// run with: zig build run-test -Doptimize=ReleaseFast -Dlibdeflate=true --
+// --no-skip
+// --test-case="BENCHMARK-inflate"
+TEST_CASE("BENCHMARK-inflate" * doctest::skip()) {
+  auto archive = ZipArchive::open("./test/fixtures/sample_sheet.xlsx").value();
+  std::vector<std::byte> buffer(64 * 1024);
+
+  std::optional<std::size_t> expectedTotal;
+  for (auto [name, backend] :
+       {std::pair{"zlib", InflateBackend::Zlib},
+        std::pair{"libdeflate", InflateBackend::Libdeflate}}) {
+    if (!isInflateBackendAvailable(backend)) {
+      MESSAGE(name, " backend not built in, skipping");
+      continue;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::size_t total = 0;
+    for (int i = 0; i < 200; ++i) {
+      for (const auto &chunk : ZipUtils::readFileChunked(
+               archive, "xl/worksheets/sheet1.xml",
+               {.inflateBackend = backend})) {
+        total += chunk.size();
+      }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    MESSAGE(name, " inflated ", total, " bytes in: ", duration.count(),
+            " micro-seconds");
+
+    if (expectedTotal.has_value()) {
+      CHECK(total == expectedTotal.value());
+    }
+    expectedTotal = total;
+  }
+}